@@ -0,0 +1,331 @@
+// Standalone microbenchmarks for the computational kernels in src/.
+//
+// Each benchmark operation corresponds to the work done for one timepoint:
+// n_particles calls to the kernel, where each call handles n_users users when
+// this applies. Dimensions that do not apply to a kernel are reported as NA.
+// Results are written as CSV (default) or JSON lines, one row per case.
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "benchmark.h"
+#include "data.h"
+#include "distances.h"
+#include "graph.h"
+#include "particle.h"
+#include "partition_functions.h"
+#include "prior.h"
+#include "random.h"
+#include "resampler.h"
+#include "rho_proposals.h"
+#include "sample_latent_rankings.h"
+
+using namespace arma;
+
+struct BenchmarkGrid {
+  std::vector<unsigned int> n_items{5, 10, 20};
+  std::vector<unsigned int> n_users{1, 10, 100};
+  std::vector<unsigned int> n_particles{100, 1000};
+  std::vector<std::string> kernels{
+    "distance", "logz", "resampler", "sample_latent_rankings",
+    "rho_proposal", "topological_sort"};
+  unsigned int max_sort_items{10};
+  unsigned int seed{1};
+  std::string cardinalities_dir{"../inst/partition_function_data"};
+  std::string output{};
+};
+
+std::vector<std::string> split_string(const std::string& x) {
+  std::vector<std::string> result;
+  std::stringstream ss(x);
+  std::string item;
+  while(std::getline(ss, item, ',')) result.push_back(item);
+  return result;
+}
+
+std::vector<unsigned int> split_unsigned(const std::string& x) {
+  std::vector<unsigned int> result;
+  for(const auto& item : split_string(x)) result.push_back(std::stoul(item));
+  return result;
+}
+
+bool run_kernel(const BenchmarkGrid& grid, const std::string& kernel) {
+  return std::find(grid.kernels.begin(), grid.kernels.end(), kernel) != grid.kernels.end();
+}
+
+uvec random_ranking(unsigned int n_items) {
+  return random_permutation(n_items) + 1;
+}
+
+umat random_rankings(unsigned int n_items, unsigned int n) {
+  umat result(n_items, n);
+  for(size_t i{}; i < n; i++) result.col(i) = random_ranking(n_items);
+  return result;
+}
+
+Prior make_prior(unsigned int n_items) {
+  Prior prior;
+  prior.n_items = n_items;
+  return prior;
+}
+
+// One timepoint of rankings, where partial rankings have the bottom half of
+// the items missing.
+std::unique_ptr<Data> make_rankings(unsigned int n_items, unsigned int n_users, bool partial) {
+  ranking_tp users;
+  for(size_t u{}; u < n_users; u++) {
+    uvec r = random_ranking(n_items);
+    if(partial) r.elem(find(r > (n_items + 1) / 2)).zeros();
+    users[std::to_string(u + 1)] = create_ranking_obs(r);
+  }
+  return std::make_unique<Rankings>(ranking_ts{users}, partial);
+}
+
+// One timepoint of pairwise preferences, where each user has a pool of
+// precomputed compatible orderings to draw from.
+std::unique_ptr<Data> make_preferences(unsigned int n_items, unsigned int n_users) {
+  const unsigned int pool_size{20};
+  pairwise_tp users;
+  sort_matrices_tp sort_matrices;
+  sort_counts_tp sort_counts;
+  for(size_t u{}; u < n_users; u++) {
+    std::string user = std::to_string(u + 1);
+    users[user] = comparisons{single_comparison(1, 2)};
+    sort_matrices[user] = conv_to<rank_mat>::from(random_rankings(n_items, pool_size));
+    sort_counts[user] = pool_size;
+  }
+  return std::make_unique<PairwisePreferences>(
+    pairwise_ts{users}, sort_matrices_ts{sort_matrices}, sort_counts_ts{sort_counts});
+}
+
+void bench_distance(const BenchmarkGrid& grid, const BenchmarkSettings& settings,
+                    BenchmarkWriter& writer) {
+  for(std::string metric : {"cayley", "footrule", "hamming", "kendall", "spearman", "ulam"}) {
+    auto distfun = choose_distance_function(metric);
+    for(auto n_items : grid.n_items) for(auto n_users : grid.n_users) {
+      for(auto n_particles : grid.n_particles) {
+        umat rankings = random_rankings(n_items, n_users);
+        umat rho = random_rankings(n_items, n_particles);
+        BenchmarkCase config{"distance", metric, n_items, n_users, n_particles,
+                             n_users * n_particles};
+        writer.write(measure(config, settings, [&]() {
+          unsigned int total{};
+          for(size_t p{}; p < n_particles; p++) {
+            for(size_t u{}; u < n_users; u++) {
+              total += distfun->d(rankings.col(u), rho.col(p));
+            }
+          }
+          do_not_optimize(total);
+        }));
+      }
+    }
+  }
+}
+
+void bench_logz(const BenchmarkGrid& grid, const BenchmarkSettings& settings,
+                BenchmarkWriter& writer) {
+  for(std::string metric : {"cayley", "hamming", "kendall", "footrule", "spearman", "ulam"}) {
+    for(auto n_items : grid.n_items) {
+      std::unique_ptr<PartitionFunction> pfun;
+      try {
+        pfun = choose_partition_function(n_items, metric, grid.cardinalities_dir);
+      } catch(std::exception& e) {
+        std::cerr << "skipping logz/" << metric << " with " << n_items
+                  << " items: " << e.what() << std::endl;
+        continue;
+      }
+      for(auto n_particles : grid.n_particles) {
+        vec alpha(n_particles);
+        alpha.imbue([](){ return random_gamma(1.0, 2.0); });
+        BenchmarkCase config{"logz", metric, n_items, 0, n_particles, n_particles};
+        writer.write(measure(config, settings, [&]() {
+          double total{};
+          for(size_t p{}; p < n_particles; p++) total += pfun->logz(alpha(p));
+          do_not_optimize(total);
+        }));
+      }
+    }
+  }
+}
+
+void bench_resampler(const BenchmarkGrid& grid, const BenchmarkSettings& settings,
+                     BenchmarkWriter& writer) {
+  for(std::string name : {"multinomial", "residual", "stratified", "systematic"}) {
+    auto resampler = choose_resampler(name);
+    for(auto n_particles : grid.n_particles) {
+      vec probs(n_particles);
+      probs.imbue([](){ return random_gamma(1.0, 1.0); });
+      probs = normalise(probs, 1);
+      BenchmarkCase config{"resampler", name, 0, 0, n_particles, 1};
+      writer.write(measure(config, settings, [&]() {
+        ivec counts = resampler->resample(n_particles, probs);
+        do_not_optimize(counts(0));
+      }));
+    }
+  }
+}
+
+void bench_sample_latent_rankings(const BenchmarkGrid& grid, const BenchmarkSettings& settings,
+                                  BenchmarkWriter& writer) {
+  for(std::string variant : {"complete", "partial_uniform", "partial_pseudo", "pairwise"}) {
+    for(auto n_items : grid.n_items) for(auto n_users : grid.n_users) {
+      Prior prior = make_prior(n_items);
+      StaticParameters parameters{prior};
+      // The Cayley partition function has a closed form for any number of items.
+      auto distfun = choose_distance_function("cayley");
+      auto pfun = choose_partition_function(n_items, "cayley", grid.cardinalities_dir);
+      std::unique_ptr<Data> data = variant == "pairwise" ?
+        make_preferences(n_items, n_users) :
+        make_rankings(n_items, n_users, variant != "complete");
+      std::string proposal = variant == "partial_pseudo" ? "pseudo" : "uniform";
+
+      for(auto n_particles : grid.n_particles) {
+        BenchmarkCase config{"sample_latent_rankings", variant, n_items, n_users,
+                             n_particles, n_particles};
+        writer.write(measure(config, settings, [&]() {
+          unsigned int total{};
+          for(size_t p{}; p < n_particles; p++) {
+            auto result = sample_latent_rankings(
+              data, 0, prior, proposal, parameters, pfun, distfun);
+            total += result.proposal(0);
+          }
+          do_not_optimize(total);
+        }));
+      }
+    }
+  }
+}
+
+void bench_rho_proposal(const BenchmarkGrid& grid, const BenchmarkSettings& settings,
+                        BenchmarkWriter& writer) {
+  const std::vector<std::pair<std::string, unsigned int>> variants{
+    {"leap_and_shift", 1}, {"leap_and_shift", 4}, {"swap", 1}, {"insertion", 1}};
+  for(const auto& [name, leap_size] : variants) {
+    std::unique_ptr<RhoProposal> rho_kernel = choose_rho_proposal(name);
+    std::string variant = name == "insertion" ? name : name + "_" + std::to_string(leap_size);
+    for(auto n_items : grid.n_items) {
+      for(auto n_particles : grid.n_particles) {
+        umat rho = random_rankings(n_items, n_particles);
+        BenchmarkCase config{"rho_proposal", variant, n_items, 0, n_particles, n_particles};
+        writer.write(measure(config, settings, [&]() {
+          double total{};
+          for(size_t p{}; p < n_particles; p++) {
+            total += rho_kernel->propose(rho.colptr(p), n_items, leap_size);
+          }
+          do_not_optimize(total);
+        }));
+      }
+    }
+  }
+}
+
+// Each user constrains the first half of a random ordering to form a chain,
+// giving n_items! / (n_items / 2)! topological sorts per user.
+void bench_topological_sort(const BenchmarkGrid& grid, const BenchmarkSettings& settings,
+                            BenchmarkWriter& writer) {
+  for(auto n_items : grid.n_items) {
+    if(n_items > grid.max_sort_items) continue;
+    for(auto n_users : grid.n_users) {
+      std::vector<Graph> graphs;
+      for(size_t u{}; u < n_users; u++) {
+        Graph g(n_items);
+        uvec ordering = random_ranking(n_items) - 1;
+        for(size_t i{1}; i < n_items / 2; i++) g.addEdge(ordering(i - 1), ordering(i));
+        graphs.push_back(g);
+      }
+      BenchmarkCase config{"topological_sort", "save_all", n_items, n_users, 0, n_users};
+      writer.write(measure(config, settings, [&]() {
+        long long int total{};
+        for(auto& g : graphs) {
+          long long int sort_count{};
+          g.alltopologicalSort(sort_count, 1);
+          total += sort_count;
+        }
+        do_not_optimize(total);
+      }));
+    }
+  }
+}
+
+void print_usage() {
+  std::cerr
+  << "Usage: bench_kernels [options]\n"
+  << "  --n-items LIST      comma separated item counts (default 5,10,20)\n"
+  << "  --n-users LIST      comma separated users per timepoint (default 1,10,100)\n"
+  << "  --n-particles LIST  comma separated particle counts (default 100,1000)\n"
+  << "  --kernels LIST      subset of distance,logz,resampler,\n"
+  << "                      sample_latent_rankings,rho_proposal,topological_sort\n"
+  << "  --max-sort-items N  largest n_items for topological_sort (default 10)\n"
+  << "  --min-time SECONDS  minimum measuring time per case (default 0.05)\n"
+  << "  --format FORMAT     csv or json (default csv)\n"
+  << "  --label LABEL       label written to each row, e.g. a release tag\n"
+  << "  --seed SEED         random seed (default 1)\n"
+  << "  --cardinalities-dir DIR\n"
+  << "                      partition function data (default ../inst/partition_function_data)\n"
+  << "  --output FILE       write results to FILE instead of stdout\n";
+}
+
+int main(int argc, char* argv[]) {
+  BenchmarkGrid grid;
+  BenchmarkSettings settings;
+
+  for(int i{1}; i < argc; i++) {
+    std::string arg{argv[i]};
+    if(arg == "--help") {
+      print_usage();
+      return 0;
+    }
+    if(i + 1 >= argc) {
+      print_usage();
+      return 1;
+    }
+    std::string value{argv[++i]};
+    if(arg == "--n-items") {
+      grid.n_items = split_unsigned(value);
+    } else if(arg == "--n-users") {
+      grid.n_users = split_unsigned(value);
+    } else if(arg == "--n-particles") {
+      grid.n_particles = split_unsigned(value);
+    } else if(arg == "--kernels") {
+      grid.kernels = split_string(value);
+    } else if(arg == "--max-sort-items") {
+      grid.max_sort_items = std::stoul(value);
+    } else if(arg == "--min-time") {
+      settings.min_time = std::stod(value);
+    } else if(arg == "--format") {
+      settings.format = value;
+    } else if(arg == "--label") {
+      settings.label = value;
+    } else if(arg == "--seed") {
+      grid.seed = std::stoul(value);
+    } else if(arg == "--cardinalities-dir") {
+      grid.cardinalities_dir = value;
+    } else if(arg == "--output") {
+      grid.output = value;
+    } else {
+      print_usage();
+      return 1;
+    }
+  }
+
+  set_random_seed(grid.seed);
+
+  std::ofstream file;
+  if(!grid.output.empty()) file.open(grid.output);
+  BenchmarkWriter writer(grid.output.empty() ? std::cout : file, settings);
+
+  if(run_kernel(grid, "distance")) bench_distance(grid, settings, writer);
+  if(run_kernel(grid, "logz")) bench_logz(grid, settings, writer);
+  if(run_kernel(grid, "resampler")) bench_resampler(grid, settings, writer);
+  if(run_kernel(grid, "sample_latent_rankings")) {
+    bench_sample_latent_rankings(grid, settings, writer);
+  }
+  if(run_kernel(grid, "rho_proposal")) bench_rho_proposal(grid, settings, writer);
+  if(run_kernel(grid, "topological_sort")) bench_topological_sort(grid, settings, writer);
+
+  return 0;
+}
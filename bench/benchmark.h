@@ -0,0 +1,117 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Size of one benchmark case. A value of zero means that the dimension does
+// not apply to the kernel, and it is reported as NA.
+struct BenchmarkCase {
+  std::string kernel;
+  std::string variant;
+  unsigned int n_items{};
+  unsigned int n_users{};
+  unsigned int n_particles{};
+  unsigned int calls_per_op{1};
+};
+
+struct BenchmarkResult {
+  BenchmarkCase config;
+  size_t repetitions{};
+  double median_ns{};
+  double mean_ns{};
+  double min_ns{};
+  double max_ns{};
+};
+
+struct BenchmarkSettings {
+  double min_time{0.05};
+  size_t min_repetitions{5};
+  size_t max_repetitions{100000};
+  std::string format{"csv"};
+  std::string label{};
+};
+
+// Sink preventing the compiler from optimizing away the benchmarked calls.
+inline volatile double benchmark_sink{};
+
+template <typename T>
+void do_not_optimize(const T& value) {
+  benchmark_sink = benchmark_sink + static_cast<double>(value);
+}
+
+template <typename F>
+BenchmarkResult measure(const BenchmarkCase& config, const BenchmarkSettings& settings, F&& op) {
+  using clock = std::chrono::steady_clock;
+  op();
+
+  std::vector<double> timings;
+  double total{};
+  while((total < settings.min_time * 1e9 || timings.size() < settings.min_repetitions) &&
+        timings.size() < settings.max_repetitions) {
+    auto start = clock::now();
+    op();
+    auto stop = clock::now();
+    double elapsed = std::chrono::duration<double, std::nano>(stop - start).count();
+    timings.push_back(elapsed);
+    total += elapsed;
+  }
+
+  BenchmarkResult result;
+  result.config = config;
+  result.repetitions = timings.size();
+  std::sort(timings.begin(), timings.end());
+  size_t mid = timings.size() / 2;
+  result.median_ns = timings.size() % 2 == 1 ? timings[mid] :
+    (timings[mid - 1] + timings[mid]) / 2;
+  result.mean_ns = total / timings.size();
+  result.min_ns = timings.front();
+  result.max_ns = timings.back();
+  return result;
+}
+
+struct BenchmarkWriter {
+  BenchmarkWriter(std::ostream& out, const BenchmarkSettings& settings) :
+  out { out }, settings { settings } {
+    if(settings.format == "csv") {
+      out << "label,kernel,variant,n_items,n_users,n_particles,calls_per_op,"
+          << "repetitions,median_ns,mean_ns,min_ns,max_ns\n";
+    }
+  }
+
+  void write(const BenchmarkResult& r) {
+    if(settings.format == "json") {
+      out << "{\"label\":\"" << settings.label << "\""
+          << ",\"kernel\":\"" << r.config.kernel << "\""
+          << ",\"variant\":\"" << r.config.variant << "\""
+          << ",\"n_items\":" << dimension(r.config.n_items, "null")
+          << ",\"n_users\":" << dimension(r.config.n_users, "null")
+          << ",\"n_particles\":" << dimension(r.config.n_particles, "null")
+          << ",\"calls_per_op\":" << r.config.calls_per_op
+          << ",\"repetitions\":" << r.repetitions
+          << ",\"median_ns\":" << r.median_ns
+          << ",\"mean_ns\":" << r.mean_ns
+          << ",\"min_ns\":" << r.min_ns
+          << ",\"max_ns\":" << r.max_ns << "}\n";
+    } else {
+      out << settings.label << "," << r.config.kernel << "," << r.config.variant << ","
+          << dimension(r.config.n_items, "NA") << ","
+          << dimension(r.config.n_users, "NA") << ","
+          << dimension(r.config.n_particles, "NA") << ","
+          << r.config.calls_per_op << "," << r.repetitions << ","
+          << r.median_ns << "," << r.mean_ns << ","
+          << r.min_ns << "," << r.max_ns << "\n";
+    }
+    out.flush();
+  }
+
+private:
+  static std::string dimension(unsigned int value, const std::string& missing) {
+    return value == 0 ? missing : std::to_string(value);
+  }
+  std::ostream& out;
+  const BenchmarkSettings& settings;
+};
@@ -1,6 +1,7 @@
 // Generated by using Rcpp::compileAttributes() -> do not edit by hand
 // Generator token: 10BE3573-1514-4C36-9D1C-5A225CD40393
 
+#include "BayesMallowsSMC2_types.h"
 #include <RcppArmadillo.h>
 #include <Rcpp.h>
 
@@ -24,9 +25,36 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// create_sampler
+Rcpp::XPtr<SMCSampler> create_sampler(Rcpp::List input_prior, Rcpp::List input_options);
+RcppExport SEXP _BayesMallowsSMC2_create_sampler(SEXP input_priorSEXP, SEXP input_optionsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type input_prior(input_priorSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type input_options(input_optionsSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_sampler(input_prior, input_options));
+    return rcpp_result_gen;
+END_RCPP
+}
+// update_sampler
+Rcpp::List update_sampler(Rcpp::XPtr<SMCSampler> sampler, Rcpp::List input_timeseries, Rcpp::List input_sort_matrices, Rcpp::List input_sort_counts, bool cluster_probabilities);
+RcppExport SEXP _BayesMallowsSMC2_update_sampler(SEXP samplerSEXP, SEXP input_timeseriesSEXP, SEXP input_sort_matricesSEXP, SEXP input_sort_countsSEXP, SEXP cluster_probabilitiesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<SMCSampler> >::type sampler(samplerSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type input_timeseries(input_timeseriesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type input_sort_matrices(input_sort_matricesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type input_sort_counts(input_sort_countsSEXP);
+    Rcpp::traits::input_parameter< bool >::type cluster_probabilities(cluster_probabilitiesSEXP);
+    rcpp_result_gen = Rcpp::wrap(update_sampler(sampler, input_timeseries, input_sort_matrices, input_sort_counts, cluster_probabilities));
+    return rcpp_result_gen;
+END_RCPP
+}
 // run_smc
-Rcpp::List run_smc(Rcpp::List input_timeseries, Rcpp::List input_prior, Rcpp::List input_options, Rcpp::List input_sort_matrices, Rcpp::List input_sort_counts);
-RcppExport SEXP _BayesMallowsSMC2_run_smc(SEXP input_timeseriesSEXP, SEXP input_priorSEXP, SEXP input_optionsSEXP, SEXP input_sort_matricesSEXP, SEXP input_sort_countsSEXP) {
+Rcpp::List run_smc(Rcpp::List input_timeseries, Rcpp::List input_prior, Rcpp::List input_options, Rcpp::List input_sort_matrices, Rcpp::List input_sort_counts, std::string resume_from);
+RcppExport SEXP _BayesMallowsSMC2_run_smc(SEXP input_timeseriesSEXP, SEXP input_priorSEXP, SEXP input_optionsSEXP, SEXP input_sort_matricesSEXP, SEXP input_sort_countsSEXP, SEXP resume_fromSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -35,14 +63,17 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< Rcpp::List >::type input_options(input_optionsSEXP);
     Rcpp::traits::input_parameter< Rcpp::List >::type input_sort_matrices(input_sort_matricesSEXP);
     Rcpp::traits::input_parameter< Rcpp::List >::type input_sort_counts(input_sort_countsSEXP);
-    rcpp_result_gen = Rcpp::wrap(run_smc(input_timeseries, input_prior, input_options, input_sort_matrices, input_sort_counts));
+    Rcpp::traits::input_parameter< std::string >::type resume_from(resume_fromSEXP);
+    rcpp_result_gen = Rcpp::wrap(run_smc(input_timeseries, input_prior, input_options, input_sort_matrices, input_sort_counts, resume_from));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
     {"_BayesMallowsSMC2_precompute_topological_sorts", (DL_FUNC) &_BayesMallowsSMC2_precompute_topological_sorts, 3},
-    {"_BayesMallowsSMC2_run_smc", (DL_FUNC) &_BayesMallowsSMC2_run_smc, 5},
+    {"_BayesMallowsSMC2_create_sampler", (DL_FUNC) &_BayesMallowsSMC2_create_sampler, 2},
+    {"_BayesMallowsSMC2_update_sampler", (DL_FUNC) &_BayesMallowsSMC2_update_sampler, 5},
+    {"_BayesMallowsSMC2_run_smc", (DL_FUNC) &_BayesMallowsSMC2_run_smc, 6},
     {NULL, NULL, 0}
 };
 
@@ -0,0 +1,12 @@
+#pragma once
+// The engine only uses Armadillo, and never the R API. Within the R package
+// Armadillo must nevertheless be included through RcppArmadillo, so that
+// every translation unit sees the same configuration.
+#ifdef BAYESMALLOWSSMC2_STANDALONE
+#ifndef ARMA_32BIT_WORD
+#define ARMA_32BIT_WORD 1
+#endif
+#include <armadillo>
+#else
+#include <RcppArmadillo.h>
+#endif
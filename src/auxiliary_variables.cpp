@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cmath>
+#include "auxiliary_variables.h"
+
+using namespace arma;
+
+double normal_cdf(double x) {
+  return .5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+void AuxiliaryVariables::allocate(unsigned int t, unsigned int n_filters) {
+  if(latent.size() <= t) latent.resize(t + 1);
+  if(latent[t].size() < n_filters) latent[t].resize(n_filters);
+}
+
+std::unique_ptr<RandomSource> AuxiliaryVariables::latent_source(
+    unsigned int t, unsigned int s) {
+  if(latent.size() <= t) latent.resize(t + 1);
+  if(latent[t].size() <= s) latent[t].resize(s + 1);
+  return std::make_unique<CorrelatedRandomSource>(latent[t][s]);
+}
+
+double AuxiliaryVariables::resampling_uniform(unsigned int t) {
+  while(resampling.n_elem <= t) {
+    resampling.resize(resampling.n_elem + 1);
+    resampling(resampling.n_elem - 1) = random_normal();
+  }
+  return normal_cdf(resampling(t));
+}
+
+AuxiliaryVariables AuxiliaryVariables::perturb(double correlation) const {
+  AuxiliaryVariables result = *this;
+  double innovation_sd = std::sqrt(1 - correlation * correlation);
+  auto move = [correlation, innovation_sd](double& x) {
+    x = correlation * x + innovation_sd * random_normal();
+  };
+  for(auto& timepoint : result.latent) {
+    for(auto& variables : timepoint) variables.for_each(move);
+  }
+  result.resampling.for_each(move);
+  return result;
+}
+
+CorrelatedRandomSource::CorrelatedRandomSource(vec& variables) :
+  variables { variables } {}
+
+double CorrelatedRandomSource::uniform() {
+  if(position == variables.n_elem) {
+    variables.resize(std::max<uword>(2 * variables.n_elem, 8));
+    for(size_t i = position; i < variables.n_elem; i++) variables(i) = random_normal();
+  }
+  return std::min(normal_cdf(variables(position++)), 1 - 1e-16);
+}
+
+unsigned int CorrelatedRandomSource::index(unsigned int n) {
+  return std::min<unsigned int>(uniform() * n, n - 1);
+}
+
+unsigned int CorrelatedRandomSource::index(const vec& probs) {
+  double target = uniform() * accu(probs);
+  double cumulative{};
+  for(size_t i{}; i < probs.n_elem; i++) {
+    cumulative += probs(i);
+    if(target < cumulative) return i;
+  }
+  return probs.n_elem - 1;
+}
+
+uvec CorrelatedRandomSource::permutation(unsigned int n) {
+  if(n == 0) return uvec{};
+  uvec result = regspace<uvec>(0, n - 1);
+  for(unsigned int i = n; i > 1; i--) {
+    std::swap(result(i - 1), result(index(i)));
+  }
+  return result;
+}
+
+size_t memory_size(const AuxiliaryVariables& auxiliary) {
+  size_t n_elem = auxiliary.resampling.n_elem;
+  for(const auto& timepoint : auxiliary.latent) {
+    for(const auto& variables : timepoint) n_elem += variables.n_elem;
+  }
+  return n_elem * sizeof(double);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "arma.h"
+#include "random.h"
+
+// Standard normal variables driving the particle filter of one particle, used
+// by the correlated pseudo-marginal move. latent[t][s] holds the variables
+// consumed when sampling latent rankings in particle filter s at timepoint t,
+// and resampling(t) the one used when resampling the particle filters at
+// timepoint t. Variables are drawn the first time they are needed.
+struct AuxiliaryVariables {
+  bool enabled{};
+  std::vector<std::vector<arma::vec>> latent{};
+  arma::vec resampling{};
+  // Makes room for the variables of n_filters particle filters at timepoint
+  // t, after which latent_source() can be called for them concurrently.
+  void allocate(unsigned int t, unsigned int n_filters);
+  std::unique_ptr<RandomSource> latent_source(unsigned int t, unsigned int s);
+  double resampling_uniform(unsigned int t);
+  // Crank-Nicolson proposal, which leaves the standard normal distribution
+  // invariant.
+  AuxiliaryVariables perturb(double correlation) const;
+};
+
+// Transforms a sequence of standard normal variables into the draws needed
+// by sample_latent_rankings(), extending the sequence when it is exhausted.
+// Each draw is a monotone function of one variable, so that nearby sequences
+// give mostly the same draws.
+struct CorrelatedRandomSource : RandomSource {
+  explicit CorrelatedRandomSource(arma::vec& variables);
+  unsigned int index(unsigned int n) override;
+  unsigned int index(const arma::vec& probs) override;
+  arma::uvec permutation(unsigned int n) override;
+  double uniform();
+  arma::vec& variables;
+  size_t position{};
+};
+
+size_t memory_size(const AuxiliaryVariables& auxiliary);
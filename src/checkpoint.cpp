@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cstdio>
+#include "checkpoint.h"
+#include "smc.h"
+
+using namespace arma;
+
+namespace {
+const char checkpoint_magic[8] = {'B', 'M', 'S', 'M', 'C', '2', 'C', 'P'};
+const uint64_t checkpoint_version{9};
+const uint64_t checkpoint_byte_order{0x0102030405060708};
+
+void write_particle_filter(CheckpointWriter& writer, const ParticleFilter& pf) {
+  writer.write_mat(all_latent_rankings(pf));
+  writer.write_mat(pf.cluster_assignments);
+  writer.write_mat(pf.log_weight);
+  writer.write_mat(pf.index);
+}
+
+void read_particle_filter(CheckpointReader& reader, ParticleFilter& pf) {
+  reader.read_mat(pf.latent_rankings);
+  reader.read_mat(pf.cluster_assignments);
+  reader.read_mat(pf.log_weight);
+  reader.read_mat(pf.index);
+}
+
+void write_particle(CheckpointWriter& writer, const Particle& p) {
+  writer.write_mat(p.parameters.alpha);
+  writer.write_mat(p.parameters.rho);
+  writer.write_mat(p.parameters.tau);
+  writer.write_mat(p.log_incremental_likelihood);
+  writer.write_mat(p.log_normalized_particle_filter_weights);
+  writer.write_double(p.weight_variance_sum);
+  writer.write_int(p.conditioned_particle_filter);
+  writer.write_mat(p.logz);
+  writer.write_int(p.particle_filters.size());
+  for(const auto& pf : p.particle_filters) write_particle_filter(writer, pf);
+  writer.write_mat(p.auxiliary.resampling);
+  writer.write_int(p.auxiliary.latent.size());
+  for(const auto& timepoint : p.auxiliary.latent) {
+    writer.write_int(timepoint.size());
+    for(const auto& variables : timepoint) writer.write_mat(variables);
+  }
+}
+
+void read_particle(CheckpointReader& reader, Particle& p) {
+  reader.read_mat(p.parameters.alpha);
+  reader.read_mat(p.parameters.rho);
+  reader.read_mat(p.parameters.tau);
+  reader.read_mat(p.log_incremental_likelihood);
+  reader.read_mat(p.log_normalized_particle_filter_weights);
+  p.weight_variance_sum = reader.read_double();
+  p.conditioned_particle_filter = reader.read_int();
+  reader.read_mat(p.logz);
+  p.particle_filters.resize(reader.read_int());
+  for(auto& pf : p.particle_filters) read_particle_filter(reader, pf);
+  reader.read_mat(p.auxiliary.resampling);
+  p.auxiliary.latent.resize(reader.read_int());
+  for(auto& timepoint : p.auxiliary.latent) {
+    timepoint.resize(reader.read_int());
+    for(auto& variables : timepoint) reader.read_mat(variables);
+  }
+}
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& filename) :
+  out(filename, std::ios::binary | std::ios::trunc) {
+  if(!out) throw std::runtime_error("Could not open checkpoint file " + filename + ".");
+}
+
+void CheckpointWriter::write_int(uint64_t x) {
+  out.write(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+void CheckpointWriter::write_double(double x) {
+  out.write(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+void CheckpointWriter::write_string(const std::string& x) {
+  write_int(x.size());
+  out.write(x.data(), x.size());
+}
+
+CheckpointReader::CheckpointReader(const std::string& filename) :
+  in(filename, std::ios::binary), filename { filename } {
+  if(!in) throw std::runtime_error("Could not open checkpoint file " + filename + ".");
+}
+
+void CheckpointReader::check() {
+  if(!in) throw std::runtime_error("Checkpoint file " + filename + " is truncated.");
+}
+
+uint64_t CheckpointReader::read_int() {
+  uint64_t x{};
+  in.read(reinterpret_cast<char*>(&x), sizeof(x));
+  check();
+  return x;
+}
+
+double CheckpointReader::read_double() {
+  double x{};
+  in.read(reinterpret_cast<char*>(&x), sizeof(x));
+  check();
+  return x;
+}
+
+std::string CheckpointReader::read_string() {
+  std::string x(read_int(), '\0');
+  in.read(&x[0], x.size());
+  check();
+  return x;
+}
+
+void SMCSampler::save_checkpoint(const std::string& filename) const {
+  // Write to a temporary file first, so that a crash while writing leaves the
+  // previous checkpoint intact.
+  const std::string tmp_filename = filename + ".tmp";
+  {
+    CheckpointWriter writer{tmp_filename};
+    writer.out.write(checkpoint_magic, sizeof(checkpoint_magic));
+    writer.write_int(checkpoint_version);
+    writer.write_int(checkpoint_byte_order);
+    writer.write_int(sizeof(uword));
+
+    writer.write_string(options.metric);
+    writer.write_int(prior.n_items);
+    writer.write_int(prior.n_clusters);
+    writer.write_int(next_timepoint);
+    // Number of users in each completed step, from which the batches are
+    // recreated on loading.
+    uvec step_users(next_timepoint);
+    for(size_t t{}; t < next_timepoint; t++) step_users(t) = data->n_users(t);
+    writer.write_mat(step_users);
+    writer.write_int(batch_size);
+    unsigned int completed = next_timepoint == 0 ? 0 : data->origin[next_timepoint - 1] + 1;
+
+    writer.write_int(options.n_particle_filters);
+    writer.write_double(log_marginal_likelihood);
+    writer.write_mat(vec(ESS.head(completed)));
+    writer.write_mat(ivec(resampling.head(completed)));
+    writer.write_mat(ivec(n_particle_filters.head(completed)));
+    writer.write_mat(ivec(n_particles.head(completed)));
+    writer.write_int(options.resampling_threshold);
+    writer.write_int(rejuvenation_sweeps);
+    writer.write_int(unique_particles);
+    writer.write_mat(tuning.alpha_scale);
+    writer.write_mat(tuning.leap_probabilities);
+    writer.write_mat(mat(tuning.alpha_scale_history.head_rows(completed)));
+    writer.write_mat(mat(tuning.leap_probabilities_history.head_rows(completed)));
+
+    writer.write_int(particle_vector.size());
+    for(const auto& p : particle_vector) write_particle(writer, p);
+    writer.write_mat(log_importance_weights);
+
+    writer.out.close();
+    if(!writer.out) {
+      throw std::runtime_error("Could not write checkpoint file " + tmp_filename + ".");
+    }
+  }
+  // rename() atomically replaces an existing checkpoint on POSIX systems. On
+  // Windows it fails if the target exists, and only then is the previous
+  // checkpoint removed first.
+  if(std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    std::remove(filename.c_str());
+    if(std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+      throw std::runtime_error("Could not write checkpoint file " + filename +
+                               ". The new checkpoint was kept in " + tmp_filename + ".");
+    }
+  }
+}
+
+void SMCSampler::load_checkpoint(const std::string& filename) {
+  CheckpointReader reader{filename};
+  char magic[sizeof(checkpoint_magic)];
+  reader.in.read(magic, sizeof(magic));
+  reader.check();
+  if(!std::equal(magic, magic + sizeof(magic), checkpoint_magic)) {
+    throw std::invalid_argument(filename + " is not a checkpoint file.");
+  }
+  if(reader.read_int() != checkpoint_version) {
+    throw std::invalid_argument("Unsupported checkpoint version in " + filename + ".");
+  }
+  if(reader.read_int() != checkpoint_byte_order || reader.read_int() != sizeof(uword)) {
+    throw std::invalid_argument("Checkpoint " + filename + " was written on an incompatible platform.");
+  }
+
+  if(reader.read_string() != options.metric) {
+    throw std::invalid_argument("Checkpoint was created with a different metric.");
+  }
+  uint64_t n_items = reader.read_int();
+  uint64_t n_clusters = reader.read_int();
+  if(n_items != static_cast<uint64_t>(prior.n_items) ||
+     n_clusters != static_cast<uint64_t>(prior.n_clusters)) {
+    throw std::invalid_argument("Checkpoint was created with a different number of items or clusters.");
+  }
+  uint64_t completed_timepoints = reader.read_int();
+  uvec step_users;
+  reader.read_mat(step_users);
+  uint64_t loaded_batch_size = reader.read_int();
+  for(size_t t{}; t < completed_timepoints && t < data->n_timepoints(); t++) {
+    data->split(t, step_users(t));
+  }
+  if(completed_timepoints > data->n_timepoints()) {
+    throw std::invalid_argument("Checkpoint contains more timepoints than the data.");
+  }
+  unsigned int completed = completed_timepoints == 0 ? 0 :
+    data->origin[completed_timepoints - 1] + 1;
+
+  options.n_particle_filters = reader.read_int();
+  log_marginal_likelihood = reader.read_double();
+  vec completed_ESS;
+  ivec completed_resampling, completed_n_particle_filters, completed_n_particles;
+  reader.read_mat(completed_ESS);
+  reader.read_mat(completed_resampling);
+  reader.read_mat(completed_n_particle_filters);
+  reader.read_mat(completed_n_particles);
+  unsigned int resampling_threshold = reader.read_int();
+  unsigned int loaded_rejuvenation_sweeps = reader.read_int();
+  unsigned int loaded_unique_particles = reader.read_int();
+  vec alpha_scale, leap_probabilities;
+  mat alpha_scale_history, leap_probabilities_history;
+  reader.read_mat(alpha_scale);
+  reader.read_mat(leap_probabilities);
+  reader.read_mat(alpha_scale_history);
+  reader.read_mat(leap_probabilities_history);
+
+  std::vector<Particle> loaded_particles(reader.read_int());
+  for(auto& p : loaded_particles) {
+    read_particle(reader, p);
+    p.auxiliary.enabled = options.pseudo_marginal_correlation > 0;
+  }
+  vec loaded_log_importance_weights;
+  reader.read_mat(loaded_log_importance_weights);
+
+  next_timepoint = completed_timepoints;
+  batch_size = loaded_batch_size;
+  ESS.head(completed) = completed_ESS;
+  resampling.head(completed) = completed_resampling;
+  n_particle_filters.head(completed) = completed_n_particle_filters;
+  n_particles.head(completed) = completed_n_particles;
+  // The threshold is scaled with the population size when it adapts.
+  if(options.adaptive_particles) options.resampling_threshold = resampling_threshold;
+  rejuvenation_sweeps = loaded_rejuvenation_sweeps;
+  unique_particles = loaded_unique_particles;
+  tuning.alpha_scale = alpha_scale;
+  tuning.leap_probabilities = leap_probabilities;
+  tuning.alpha_scale_history.head_rows(completed) = alpha_scale_history;
+  tuning.leap_probabilities_history.head_rows(completed) = leap_probabilities_history;
+  options.n_particles = loaded_particles.size();
+  particle_vector = std::move(loaded_particles);
+  log_importance_weights = loaded_log_importance_weights;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include "arma.h"
+
+// Binary serialization used for checkpoints of the sampler state. Scalars are
+// written as their in-memory representation, strings as their length followed
+// by their characters, and Armadillo matrices and vectors as their number of
+// rows and columns followed by their elements in column-major order.
+struct CheckpointWriter {
+  explicit CheckpointWriter(const std::string& filename);
+  void write_int(uint64_t x);
+  void write_double(double x);
+  void write_string(const std::string& x);
+  template<typename eT> void write_mat(const arma::Mat<eT>& x) {
+    write_int(x.n_rows);
+    write_int(x.n_cols);
+    out.write(reinterpret_cast<const char*>(x.memptr()), x.n_elem * sizeof(eT));
+  }
+  std::ofstream out;
+};
+
+struct CheckpointReader {
+  explicit CheckpointReader(const std::string& filename);
+  uint64_t read_int();
+  double read_double();
+  std::string read_string();
+  template<typename eT> void read_mat(arma::Mat<eT>& x) {
+    uint64_t n_rows = read_int();
+    uint64_t n_cols = read_int();
+    x.set_size(n_rows, n_cols);
+    in.read(reinterpret_cast<char*>(x.memptr()), x.n_elem * sizeof(eT));
+    check();
+  }
+  void check();
+  std::ifstream in;
+  const std::string filename;
+};
@@ -1,7 +1,8 @@
 #include <math.h>
+#include <iterator>
+#include <stdexcept>
 #include "data.h"
 #include "misc.h"
-#include "sample_latent_rankings.h"
 
 using namespace arma;
 
@@ -15,98 +16,106 @@ uvec find_available_items(const uvec& observed_ranking) {
   return setdiff(available_items, find(observed_ranking));
 }
 
-Rankings::Rankings(const Rcpp::List& input_timeseries, bool partial_rankings) :
-  partial_rankings { partial_rankings } {
-  timeseries.reserve(input_timeseries.size());
-  for(Rcpp::List a : input_timeseries) {
-    ranking_tp new_data;
-    Rcpp::CharacterVector nm = a.names();
-    for(size_t i{}; i < nm.size(); i++) {
-      // 1. Read as Rcpp vector to safely check for NA
-      Rcpp::NumericVector r_vec = a[i];
-
-      // 2. Create a clean Armadillo vector, forcing NAs to 0
-      arma::uvec clean_vec(r_vec.size());
-      for(int j = 0; j < r_vec.size(); ++j) {
-        if (Rcpp::NumericVector::is_na(r_vec[j])) {
-          clean_vec[j] = 0; // Explicitly mark as missing
-        } else {
-          clean_vec[j] = (unsigned int)r_vec[j];
-        }
-      }
-
-      // 3. Use the clean vector
-      new_data[std::string(nm[i])] = RankingObs{
-        clean_vec,
-        find_available_items(clean_vec),
-        find_available_rankings(clean_vec)
-      };
-    }
-    timeseries.push_back(new_data);
+RankingObs create_ranking_obs(const uvec& observation) {
+  return RankingObs{
+    observation,
+    find_available_items(observation),
+    find_available_rankings(observation)
+  };
+}
+
+unsigned int Data::n_original_timepoints() const {
+  return origin.empty() ? 0 : origin.back() + 1;
+}
+
+bool Data::completes_timepoint(unsigned int t) const {
+  return t + 1 >= origin.size() || origin[t + 1] != origin[t];
+}
+
+void Data::add_origins(unsigned int n_timepoints) {
+  unsigned int first = n_original_timepoints();
+  for(unsigned int i{}; i < n_timepoints; i++) origin.push_back(first + i);
+}
+
+void Data::split_origin(unsigned int t) {
+  origin.insert(origin.begin() + t + 1, origin[t]);
+}
+
+// Moves the users after the first n_users of timepoint t to a new timepoint
+// inserted after it.
+template <typename T>
+void split_timepoint(std::vector<T>& timeseries, unsigned int t, unsigned int n_users) {
+  auto first = std::next(timeseries[t].begin(), n_users);
+  T rest(std::make_move_iterator(first), std::make_move_iterator(timeseries[t].end()));
+  timeseries[t].erase(first, timeseries[t].end());
+  timeseries.insert(timeseries.begin() + t + 1, std::move(rest));
+}
+
+// Moves the entries of timepoint t belonging to the given users to a new
+// timepoint inserted after it.
+template <typename T, typename U>
+void split_timepoint_by_users(std::vector<T>& timeseries, unsigned int t, const U& users) {
+  if(t >= timeseries.size()) return;
+  T moved;
+  for(const auto& user : users) {
+    auto it = timeseries[t].find(user.first);
+    if(it == timeseries[t].end()) continue;
+    moved.insert(std::move(*it));
+    timeseries[t].erase(it);
   }
-  original_timeseries = timeseries;
+  timeseries.insert(timeseries.begin() + t + 1, std::move(moved));
+}
+
+Rankings::Rankings(const ranking_ts& timeseries, bool partial_rankings) :
+  timeseries { timeseries },
+  partial_rankings { partial_rankings } {
+  add_origins(timeseries.size());
 }
 
 PairwisePreferences::PairwisePreferences(
-  const Rcpp::List& input_timeseries,
-  const Rcpp::List& input_sort_matrices,
-  const Rcpp::List& input_sort_counts
-) {
-  timeseries.reserve(input_timeseries.size());
-
-  for(Rcpp::List a : input_timeseries) {
-    pairwise_tp new_data;
-    Rcpp::CharacterVector nm = a.names();
-    for(size_t i{}; i < nm.size(); i++) {
-      umat preferences = a[i];
-      comparisons user_data;
-      for(size_t j{}; j < preferences.n_rows; j++) {
-        user_data.insert(single_comparison(preferences(j, 0), preferences(j, 1)));
-      }
-      new_data[std::string(nm[i])] = user_data;
-    }
-    timeseries.push_back(new_data);
-  }
-  original_timeseries = timeseries;
-
-  sort_matrix_timeseries.reserve(input_sort_matrices.size());
-
-  for(Rcpp::List a : input_sort_matrices) {
-    sort_matrices_tp new_data;
-    Rcpp::CharacterVector nm = a.names();
-    for(size_t i{}; i < nm.size(); i++) {
-      umat sort_matrix = a[i];
-      new_data[std::string(nm[i])] = sort_matrix;
-    }
-    sort_matrix_timeseries.push_back(new_data);
-  }
+  const pairwise_ts& timeseries,
+  const sort_matrices_ts& sort_matrix_timeseries,
+  const sort_counts_ts& sort_count_timeseries
+) :
+  timeseries { timeseries },
+  sort_matrix_timeseries { sort_matrix_timeseries },
+  sort_count_timeseries { sort_count_timeseries } {
+  add_origins(timeseries.size());
+}
 
-  sort_count_timeseries.reserve(input_sort_counts.size());
-  for(Rcpp::List a : input_sort_counts) {
-    sort_counts_tp new_data;
-    Rcpp::CharacterVector nm = a.names();
-    for(size_t i{}; i < nm.size(); i++) {
-      new_data[std::string(nm[i])] = a[i];
-    }
-    sort_count_timeseries.push_back(new_data);
-  }
+void Rankings::append(const Data& other) {
+  const Rankings* new_data = dynamic_cast<const Rankings*>(&other);
+  if(!new_data) throw std::invalid_argument("New data must be rankings.");
+  add_origins(new_data->timeseries.size());
+  timeseries.insert(timeseries.end(), new_data->timeseries.begin(),
+                    new_data->timeseries.end());
+  partial_rankings = partial_rankings || new_data->partial_rankings;
 }
 
-std::unique_ptr<Data> setup_data(
-    const Rcpp::List& input_timeseries,
-    const Rcpp::List& input_sort_matrices,
-    const Rcpp::List& input_sort_counts
-) {
-  std::string type = Rcpp::as<std::string>(input_timeseries.attr("type"));
-
-  if (type == "complete rankings" || type == "partial rankings") {
-    return std::make_unique<Rankings>(input_timeseries, type == "partial rankings");
-  } else if (type == "pairwise preferences") {
-    return std::make_unique<PairwisePreferences>(
-      input_timeseries, input_sort_matrices, input_sort_counts
-      );
-  } else {
-    Rcpp::stop("Wrong data type.");
-  }
+void PairwisePreferences::append(const Data& other) {
+  const PairwisePreferences* new_data = dynamic_cast<const PairwisePreferences*>(&other);
+  if(!new_data) throw std::invalid_argument("New data must be pairwise preferences.");
+  add_origins(new_data->timeseries.size());
+  timeseries.insert(timeseries.end(), new_data->timeseries.begin(),
+                    new_data->timeseries.end());
+  sort_matrix_timeseries.insert(sort_matrix_timeseries.end(),
+                                new_data->sort_matrix_timeseries.begin(),
+                                new_data->sort_matrix_timeseries.end());
+  sort_count_timeseries.insert(sort_count_timeseries.end(),
+                               new_data->sort_count_timeseries.begin(),
+                               new_data->sort_count_timeseries.end());
 }
 
+void Rankings::split(unsigned int t, unsigned int n_users) {
+  if(n_users == 0 || n_users >= timeseries[t].size()) return;
+  split_timepoint(timeseries, t, n_users);
+  split_origin(t);
+}
+
+void PairwisePreferences::split(unsigned int t, unsigned int n_users) {
+  if(n_users == 0 || n_users >= timeseries[t].size()) return;
+  split_timepoint(timeseries, t, n_users);
+  split_timepoint_by_users(sort_matrix_timeseries, t, timeseries[t + 1]);
+  split_timepoint_by_users(sort_count_timeseries, t, timeseries[t + 1]);
+  split_origin(t);
+}
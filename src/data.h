@@ -1,10 +1,10 @@
 #pragma once
-#include <RcppArmadillo.h>
 #include <memory>
 #include <algorithm>
 #include <vector>
 #include <string>
 #include <map>
+#include "arma.h"
 #include "typedefs.h"
 #include "prior.h"
 
@@ -12,33 +12,49 @@ struct Data{
   Data(){};
   virtual ~Data() = default;
   virtual unsigned int n_timepoints() = 0;
+  virtual unsigned int n_users(unsigned int t) = 0;
+  // Adds the timepoints of other, which must be of the same type, after the
+  // existing ones.
+  virtual void append(const Data& other) = 0;
+  // Splits timepoint t into a batch with its first n_users users, in the
+  // order of their ids, and the remaining users, which become timepoint t + 1.
+  virtual void split(unsigned int t, unsigned int n_users) = 0;
+
+  // Original timepoint of each timepoint, which differs from its position
+  // after split().
+  std::vector<unsigned int> origin{};
+  unsigned int n_original_timepoints() const;
+  // Whether timepoint t is the last batch of its original timepoint.
+  bool completes_timepoint(unsigned int t) const;
+
+protected:
+  void add_origins(unsigned int n_timepoints);
+  void split_origin(unsigned int t);
 };
 
 struct Rankings : Data {
-  Rankings(const Rcpp::List& input_timeseries, bool partial_rankings);
+  Rankings(const ranking_ts& timeseries, bool partial_rankings);
   ranking_ts timeseries;
-  ranking_ts original_timeseries;
   unsigned int n_timepoints() override { return timeseries.size(); }
+  unsigned int n_users(unsigned int t) override { return timeseries[t].size(); }
+  void append(const Data& other) override;
+  void split(unsigned int t, unsigned int n_users) override;
   bool partial_rankings{};
 };
 
 struct PairwisePreferences : Data{
   PairwisePreferences(
-    const Rcpp::List& input_timeseries,
-    const Rcpp::List& input_sort_matrices,
-    const Rcpp::List& input_sort_counts
+    const pairwise_ts& timeseries,
+    const sort_matrices_ts& sort_matrix_timeseries,
+    const sort_counts_ts& sort_count_timeseries
   );
   pairwise_ts timeseries;
-  pairwise_ts original_timeseries;
   unsigned int n_timepoints() override { return timeseries.size(); }
+  unsigned int n_users(unsigned int t) override { return timeseries[t].size(); }
+  void append(const Data& other) override;
+  void split(unsigned int t, unsigned int n_users) override;
   sort_matrices_ts sort_matrix_timeseries;
   sort_counts_ts sort_count_timeseries;
 };
 
-std::unique_ptr<Data> setup_data(
-    const Rcpp::List& input_timeseries,
-    const Rcpp::List& input_sort_matrices,
-    const Rcpp::List& input_sort_counts
-);
-
-
+RankingObs create_ranking_obs(const arma::uvec& observation);
@@ -0,0 +1,58 @@
+#include "diagnostics.h"
+
+using namespace arma;
+
+Diagnostics::Diagnostics(bool enabled, unsigned int n_timepoints) :
+  enabled { enabled },
+  inner_ess { zeros(n_timepoints, 5) },
+  log_incremental_likelihood_variance { zeros(n_timepoints) },
+  log_likelihood_estimator_variance { zeros(n_timepoints) },
+  acceptance_rates(n_timepoints),
+  unique_alphas { zeros<uvec>(n_timepoints) },
+  unique_rhos { zeros<uvec>(n_timepoints) },
+  rejuvenation_steps { zeros<uvec>(n_timepoints) },
+  tempering_steps { zeros<uvec>(n_timepoints) } {}
+
+void Diagnostics::resize(unsigned int n_timepoints) {
+  inner_ess.resize(n_timepoints, 5);
+  log_incremental_likelihood_variance.resize(n_timepoints);
+  log_likelihood_estimator_variance.resize(n_timepoints);
+  acceptance_rates.resize(n_timepoints);
+  unique_alphas.resize(n_timepoints);
+  unique_rhos.resize(n_timepoints);
+  rejuvenation_steps.resize(n_timepoints);
+  tempering_steps.resize(n_timepoints);
+}
+
+// The incremental likelihoods are summed over the SMC steps first_step to
+// last_step, which are the batches of timepoint t processed so far.
+void Diagnostics::update_propagation(
+    const std::vector<Particle>& particle_vector, unsigned int t,
+    unsigned int first_step, unsigned int last_step) {
+  if(!enabled) return;
+
+  vec ess(particle_vector.size());
+  vec log_incremental_likelihood(particle_vector.size());
+  for(size_t i{}; i < particle_vector.size(); i++) {
+    ess(i) = 1 / accu(exp(2 * particle_vector[i].log_normalized_particle_filter_weights));
+    log_incremental_likelihood(i) =
+      accu(particle_vector[i].log_incremental_likelihood.subvec(first_step, last_step));
+  }
+
+  inner_ess.row(t) = quantile(ess, vec{0, .25, .5, .75, 1}).t();
+  log_incremental_likelihood_variance(t) = var(log_incremental_likelihood);
+}
+
+void Diagnostics::update_population(
+    const std::vector<Particle>& particle_vector, const ParticlePopulation& population,
+    unsigned int t) {
+  if(!enabled) return;
+  unique_alphas(t) = find_unique_alphas(population);
+  unique_rhos(t) = find_unique_rhos(population);
+
+  double estimator_variance{};
+  for(const auto& p : particle_vector) {
+    estimator_variance += p.weight_variance_sum / p.particle_filters.size();
+  }
+  log_likelihood_estimator_variance(t) = estimator_variance / particle_vector.size();
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include "arma.h"
+#include "particle.h"
+
+// Per-timepoint diagnostics of the statistical efficiency of the sampler.
+// Nothing is recorded unless enabled is true.
+struct Diagnostics {
+  Diagnostics(bool enabled, unsigned int n_timepoints);
+  void resize(unsigned int n_timepoints);
+  const bool enabled;
+  // Minimum, lower quartile, median, upper quartile and maximum across
+  // particles of the effective sample size of the particle filters.
+  arma::mat inner_ess;
+  arma::vec log_incremental_likelihood_variance;
+  // Mean across particles of the estimated variance of the log-likelihood
+  // estimate of the particle filters, given all timepoints so far.
+  arma::vec log_likelihood_estimator_variance;
+  std::vector<std::vector<double>> acceptance_rates;
+  arma::uvec unique_alphas;
+  arma::uvec unique_rhos;
+  arma::uvec rejuvenation_steps;
+  // Number of intermediate tempering exponents with adaptive tempering.
+  arma::uvec tempering_steps;
+  void update_propagation(const std::vector<Particle>& particle_vector, unsigned int t,
+                          unsigned int first_step, unsigned int last_step);
+  void update_population(const std::vector<Particle>& particle_vector,
+                         const ParticlePopulation& population, unsigned int t);
+};
@@ -1,3 +1,4 @@
+#include <stdexcept>
 #include "distances.h"
 using namespace arma;
 
@@ -15,7 +16,7 @@ std::unique_ptr<Distance> choose_distance_function(const std::string& metric) {
   } else if(metric == "ulam") {
     return std::make_unique<UlamDistance>();
   } else {
-    Rcpp::stop("Unknown metric.");
+    throw std::invalid_argument("Unknown metric.");
   }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <memory>
-#include <RcppArmadillo.h>
+#include <string>
+#include "arma.h"
 
 struct Distance {
   Distance() {};
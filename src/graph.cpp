@@ -0,0 +1,69 @@
+// Based on https://www.geeksforgeeks.org/all-topological-sorts-of-a-directed-acyclic-graph/
+
+#include <list>
+#include <vector>
+#include "graph.h"
+#include "random.h"
+using namespace std;
+
+Graph::Graph(int n_items) : n_items { n_items }, adj(n_items),
+indegree(n_items, 0) {}
+
+void Graph::addEdge(int v, int w) {
+  adj[v].push_back(w);
+  indegree[w]++;
+}
+
+void Graph::alltopologicalSortUtil(
+    vector<int>& res, vector<bool>& visited, long long int& sort_count,
+    std::vector<arma::ivec>& sorts, double save_frac) {
+  bool flag = false;
+
+  for (size_t i{}; i < n_items; i++) {
+    if (indegree[i] == 0 && !visited[i]) {
+      list<int>::iterator j;
+      for (j = adj[i].begin(); j != adj[i].end(); j++)
+        indegree[*j]--;
+
+      res.push_back(i);
+      visited[i] = true;
+      alltopologicalSortUtil(res, visited, sort_count, sorts, save_frac);
+
+      visited[i] = false;
+      res.erase(res.end() - 1);
+      for (j = adj[i].begin(); j != adj[i].end(); j++)
+        indegree[*j]++;
+
+      flag = true;
+    }
+  }
+
+  if (!flag){
+    if(random_uniform() < save_frac) {
+      arma::ivec sort_vector(res.size());
+      for(size_t i = 0; i < res.size(); ++i) {
+        sort_vector(i) = res[i] + 1; // converting to 1-based indexing
+      }
+      sorts.push_back(sort_vector);
+    }
+    sort_count++;
+  }
+}
+
+arma::imat Graph::alltopologicalSort(long long int& sort_count, double save_frac) {
+  vector<bool> visited(n_items, false);
+  vector<int> res;
+  std::vector<arma::ivec> sorts;
+  alltopologicalSortUtil(res, visited, sort_count, sorts, save_frac);
+
+  if(sorts.empty()) {
+    return arma::imat(0, 0);
+  }
+
+  arma::imat sort_matrix(sorts[0].n_elem, sorts.size());
+  for (size_t i = 0; i < sorts.size(); ++i) {
+    sort_matrix.col(i) = sorts[i];
+  }
+
+  return sort_matrix;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "arma.h"
+#include <list>
+#include <vector>
+
+class Graph {
+  int n_items;
+  std::vector<std::list<int>> adj;
+  std::vector<int> indegree;
+  void alltopologicalSortUtil(
+      std::vector<int>& res, std::vector<bool>& visited, long long int& sort_count,
+      std::vector<arma::ivec>& sorts, double save_frac);
+
+public:
+  Graph(int n_items);
+  void addEdge(int v, int w);
+  arma::imat alltopologicalSort(long long int& sort_count, double save_frac);
+};
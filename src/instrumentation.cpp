@@ -0,0 +1,41 @@
+#include "instrumentation.h"
+
+using namespace arma;
+
+Instrumentation::Instrumentation(bool enabled, unsigned int n_timepoints) :
+  enabled { enabled },
+  propagation { zeros(n_timepoints) },
+  weighting { zeros(n_timepoints) },
+  resampling { zeros(n_timepoints) },
+  rejuvenation { zeros(n_timepoints) },
+  tau_gibbs { zeros(n_timepoints) },
+  doubling { zeros(n_timepoints) },
+  sweep_times(n_timepoints) {}
+
+void Instrumentation::resize(unsigned int n_timepoints) {
+  propagation.resize(n_timepoints);
+  weighting.resize(n_timepoints);
+  resampling.resize(n_timepoints);
+  rejuvenation.resize(n_timepoints);
+  tau_gibbs.resize(n_timepoints);
+  doubling.resize(n_timepoints);
+  sweep_times.resize(n_timepoints);
+}
+
+CountingDistance::CountingDistance(
+  std::unique_ptr<Distance> distfun, std::atomic<unsigned long long>& calls) :
+  distfun { std::move(distfun) }, calls { calls } {}
+
+unsigned int CountingDistance::d(const uvec& r1, const uvec& r2) {
+  calls++;
+  return distfun->d(r1, r2);
+}
+
+CountingPartitionFunction::CountingPartitionFunction(
+  std::unique_ptr<PartitionFunction> pfun, std::atomic<unsigned long long>& calls) :
+  pfun { std::move(pfun) }, calls { calls } {}
+
+double CountingPartitionFunction::logz(double alpha) {
+  calls++;
+  return pfun->logz(alpha);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "arma.h"
+#include "distances.h"
+#include "partition_functions.h"
+
+struct Stopwatch {
+  std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+  double elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+};
+
+// Wall-clock time in seconds spent in each phase of the sampler, per
+// timepoint, together with counters of the most expensive operations. Nothing
+// is recorded unless enabled is true.
+struct Instrumentation {
+  Instrumentation(bool enabled, unsigned int n_timepoints);
+  void resize(unsigned int n_timepoints);
+  const bool enabled;
+  arma::vec propagation;
+  arma::vec weighting;
+  arma::vec resampling;
+  arma::vec rejuvenation;
+  arma::vec tau_gibbs;
+  arma::vec doubling;
+  std::vector<std::vector<double>> sweep_times;
+  // Atomic, since particle filters may run in parallel.
+  std::atomic<unsigned long long> distance_calls{};
+  std::atomic<unsigned long long> logz_calls{};
+  unsigned long long particle_filter_reruns{};
+  unsigned long long screened_proposals{};
+  std::atomic<unsigned long long> bytes_copied{};
+};
+
+// Decorators counting calls to the wrapped distance and partition function.
+struct CountingDistance : Distance {
+  CountingDistance(std::unique_ptr<Distance> distfun, std::atomic<unsigned long long>& calls);
+  unsigned int d(const arma::uvec& r1, const arma::uvec& r2) override;
+  std::unique_ptr<Distance> distfun;
+  std::atomic<unsigned long long>& calls;
+};
+
+struct CountingPartitionFunction : PartitionFunction {
+  CountingPartitionFunction(std::unique_ptr<PartitionFunction> pfun, std::atomic<unsigned long long>& calls);
+  double logz(double alpha) override;
+  std::unique_ptr<PartitionFunction> pfun;
+  std::atomic<unsigned long long>& calls;
+};
@@ -1,5 +1,5 @@
-#include <RcppArmadillo.h>
 #include <algorithm>
+#include "misc.h"
 #include <vector>
 
 using namespace arma;
@@ -1,5 +1,5 @@
 #pragma once
-#include <RcppArmadillo.h>
+#include "arma.h"
 arma::uvec setdiff(const arma::uvec& x1, const arma::uvec& x2);
 double log_sum_exp(const arma::vec& x);
 double log_mean_exp(const arma::vec& x);
@@ -0,0 +1,36 @@
+// [[Rcpp::depends(RcppArmadillo)]]
+#include <RcppArmadillo.h>
+#include "rcpp_adapter.h"
+#include "smc.h"
+
+// [[Rcpp::export]]
+Rcpp::XPtr<SMCSampler> create_sampler(
+  Rcpp::List input_prior,
+  Rcpp::List input_options
+) {
+  Prior prior = read_prior(input_prior);
+  Options options = read_options(input_options);
+
+  SMCSampler* sampler = new SMCSampler{
+    std::make_unique<Rankings>(ranking_ts{}, false),
+    prior, options,
+    choose_partition_function(prior.n_items, options.metric, cardinalities_dir()),
+    Rcpp::Rcout
+  };
+  sampler->interrupt_requested = r_interrupt_requested;
+  return Rcpp::XPtr<SMCSampler>(sampler, true);
+}
+
+// [[Rcpp::export]]
+Rcpp::List update_sampler(
+  Rcpp::XPtr<SMCSampler> sampler,
+  Rcpp::List input_timeseries,
+  Rcpp::List input_sort_matrices,
+  Rcpp::List input_sort_counts,
+  bool cluster_probabilities
+) {
+  sampler->add_timepoints(
+    read_data(input_timeseries, input_sort_matrices, input_sort_counts));
+  sampler->run();
+  return wrap_result(*sampler, cluster_probabilities);
+}
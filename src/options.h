@@ -1,21 +1,49 @@
 #pragma once
-#include <RcppArmadillo.h>
+#include <cstddef>
 #include <string>
 
 struct Options{
-  Options(const Rcpp::List& input_options);
-  ~Options() = default;
-
-  const std::string metric;
-  const std::string resampler;
-  const std::string latent_rank_proposal;
-  unsigned int n_particles;
-  unsigned int n_particle_filters;
-  unsigned int max_particle_filters;
-  unsigned int resampling_threshold;
-  unsigned int max_rejuvenation_steps;
-  const double doubling_threshold;
-  const bool verbose;
-  const bool trace;
-  const bool trace_latent;
+  std::string metric{"footrule"};
+  std::string resampler{"multinomial"};
+  std::string latent_rank_proposal{"uniform"};
+  std::string rho_proposal{"leap_and_shift"};
+  unsigned int leap_size{1};
+  unsigned int n_particles{1000};
+  bool adaptive_particles{};
+  unsigned int min_particles{100};
+  unsigned int max_particles{10000};
+  unsigned int n_particle_filters{50};
+  unsigned int max_particle_filters{10000};
+  unsigned int resampling_threshold{500};
+  unsigned int max_rejuvenation_steps{20};
+  double doubling_threshold{.2};
+  double target_log_likelihood_variance{};
+  bool adaptive_tempering{};
+  unsigned int batch_size{};
+  bool adaptive_batch_size{};
+  double pseudo_marginal_correlation{};
+  bool ancestor_sampling{};
+  bool fuse_tau_update{};
+  unsigned int cluster_block_size{};
+  unsigned int delayed_acceptance_filters{};
+  bool adaptive_proposals{};
+  bool verbose{};
+  bool trace{};
+  bool trace_latent{};
+  std::string trace_file{};
+  size_t trace_buffer_size{1 << 20};
+  std::string checkpoint_file{};
+  // Bytes of memory for the particles, or zero for no limit. When exceeded,
+  // latent rankings are moved to scratch_file.
+  double memory_budget{};
+  std::string scratch_file{};
+  unsigned int checkpoint_interval{1};
+  bool instrument{};
+  // Time limit in seconds for each call to SMCSampler::run(), or zero for none.
+  double time_limit{};
+  bool diagnostics{};
+  // Threads propagating and rejuvenating the particles. Only the standalone
+  // build, where each thread has its own random number generator, supports
+  // more than one.
+  unsigned int n_threads{1};
 };
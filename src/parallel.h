@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <exception>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Task parallelism over particles and particle filters. with_threads() starts
+// a team of threads running f on one of them, and parallel_for() called from
+// f, directly or from within another parallel_for(), splits its iterations
+// into tasks. Nested loops give (particle, particle filter) tasks, and idle
+// threads take tasks queued by busy ones, which balances particles of very
+// different cost. Without OpenMP, or with a single thread, everything runs
+// sequentially in the usual order.
+//
+// Exceptions cannot cross the boundary of an OpenMP task, so the first one
+// thrown is rethrown after the loop or team has finished.
+
+template<typename F>
+void with_threads(unsigned int n_threads, F f) {
+#ifdef _OPENMP
+  if(n_threads > 1) {
+    std::exception_ptr error;
+#pragma omp parallel num_threads(n_threads) shared(f, error)
+#pragma omp single
+    {
+      try {
+        f();
+      } catch(...) {
+        error = std::current_exception();
+      }
+    }
+    if(error) std::rethrow_exception(error);
+    return;
+  }
+#endif
+  f();
+}
+
+template<typename F>
+void parallel_for(size_t n, F f) {
+#ifdef _OPENMP
+  if(omp_in_parallel()) {
+    std::exception_ptr error;
+#pragma omp taskloop grainsize(1) shared(f, error)
+    for(size_t i = 0; i < n; i++) {
+      try {
+        f(i);
+      } catch(...) {
+#pragma omp critical(parallel_for_error)
+        if(!error) error = std::current_exception();
+      }
+    }
+    if(error) std::rethrow_exception(error);
+    return;
+  }
+#endif
+  for(size_t i{}; i < n; i++) f(i);
+}
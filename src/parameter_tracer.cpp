@@ -2,41 +2,57 @@
 #include "parameter_tracer.h"
 using namespace arma;
 
-ParameterTracer::ParameterTracer(bool trace, bool trace_latent)
-  : trace { trace }, trace_latent { trace_latent } {}
+ParameterTracer::ParameterTracer(
+  bool trace, bool trace_latent, const std::string& trace_file,
+  size_t trace_buffer_size)
+  : trace { trace }, trace_latent { trace_latent }, trace_file { trace_file } {
+  if((trace || trace_latent) && !trace_file.empty()) {
+    writer = std::make_unique<TraceWriter>(trace_file, trace_buffer_size);
+  }
+}
+
+void ParameterTracer::flush() {
+  if(writer) writer->flush();
+}
 
-void ParameterTracer::update_trace(const std::vector<Particle>& pvec, int t) {
+void ParameterTracer::update_trace(
+    const std::vector<Particle>& pvec, const ParticlePopulation& population,
+    const vec& log_importance_weights, int t) {
   if(trace) {
-    mat alpha(pvec[0].parameters.alpha.n_rows, pvec.size());
-    for(size_t i{}; i < pvec.size(); i++) {
-      alpha.col(i) = pvec[i].parameters.alpha;
+    if(writer) {
+      writer->write(TraceField::alpha, t, 0, population.alpha);
+    } else {
+      alpha_traces.push_back(population.alpha);
     }
-    alpha_traces.push_back(alpha);
-
-    ucube rho(pvec[0].parameters.rho.n_rows, pvec[0].parameters.rho.n_cols,
-              pvec.size());
 
-    for(size_t i{}; i < pvec.size(); i++) {
-      rho.slice(i) = pvec[i].parameters.rho;
+    if(writer) {
+      writer->write(TraceField::rho, t, 0, population.rho);
+    } else {
+      rho_traces.push_back(conv_to<rank_cube>::from(population.rho));
     }
-    rho_traces.push_back(rho);
 
-    mat tau(pvec[0].parameters.tau.n_rows, pvec.size());
-    for(size_t i{}; i < pvec.size(); i++) {
-      tau.col(i) = pvec[i].parameters.tau;
+    if(writer) {
+      writer->write(TraceField::tau, t, 0, population.tau);
+    } else {
+      tau_traces.push_back(population.tau);
     }
-    tau_traces.push_back(tau);
 
-    vec log_importance_weights(pvec.size());
-    for(size_t i{}; i < pvec.size(); i++) {
-      log_importance_weights(i) = pvec[i].log_importance_weight;
+    if(writer) {
+      writer->write(TraceField::log_importance_weights, t, 0, log_importance_weights);
+    } else {
+      log_importance_weights_traces.push_back(log_importance_weights);
     }
-    log_importance_weights_traces.push_back(log_importance_weights);
   }
-  if(trace_latent) {
-    std::vector<arma::umat> current_latent_rankings;
+  if(trace_latent && writer) {
+    for(size_t i{}; i < pvec.size(); i++) {
+      writer->write(TraceField::latent_rankings, t, i, conv_to<umat>::from(
+        all_latent_rankings(pvec[i].particle_filters[pvec[i].conditioned_particle_filter])));
+    }
+  } else if(trace_latent) {
+    std::vector<rank_mat> current_latent_rankings;
     for(size_t i{}; i < pvec.size(); i++) {
-      current_latent_rankings.push_back(pvec[i].particle_filters[pvec[i].conditioned_particle_filter].latent_rankings);
+      current_latent_rankings.push_back(
+        all_latent_rankings(pvec[i].particle_filters[pvec[i].conditioned_particle_filter]));
     }
     latent_rankings_traces.push_back(current_latent_rankings);
   }
@@ -1,16 +1,26 @@
+#include <memory>
 #include <string>
 #include "particle.h"
+#include "trace_writer.h"
 #pragma once
 
+// Keeps the traces in memory, unless trace_file is non-empty, in which case
+// each snapshot is streamed to that file and only trace_buffer_size bytes are
+// held in memory.
 struct ParameterTracer{
-  ParameterTracer(bool trace, bool trace_latent);
+  ParameterTracer(bool trace, bool trace_latent, const std::string& trace_file = "",
+                  size_t trace_buffer_size = 1 << 20);
   ~ParameterTracer() = default;
   bool trace;
   bool trace_latent;
+  std::string trace_file;
+  std::unique_ptr<TraceWriter> writer{};
   std::vector<arma::mat> alpha_traces{};
-  std::vector<arma::ucube> rho_traces{};
+  std::vector<rank_cube> rho_traces{};
   std::vector<arma::mat> tau_traces{};
   std::vector<arma::vec> log_importance_weights_traces{};
-  std::vector<std::vector<arma::umat>> latent_rankings_traces{};
-  void update_trace(const std::vector<Particle>& pvec, int t);
+  std::vector<std::vector<rank_mat>> latent_rankings_traces{};
+  void update_trace(const std::vector<Particle>& pvec, const ParticlePopulation& population,
+                    const arma::vec& log_importance_weights, int t);
+  void flush();
 };
@@ -1,8 +1,9 @@
 #include <algorithm>
 #include <vector>
-#include <Rmath.h>
 #include "misc.h"
+#include "parallel.h"
 #include "particle.h"
+#include "random.h"
 #include "sample_latent_rankings.h"
 
 using namespace arma;
@@ -11,28 +12,41 @@ StaticParameters::StaticParameters(const vec& alpha, const umat& rho, const vec&
   alpha { alpha }, rho { rho }, tau { tau } {}
 
 StaticParameters::StaticParameters(const Prior& prior) :
-  alpha { Rcpp::rgamma(prior.n_clusters, prior.alpha_shape, 1 / prior.alpha_rate) },
+  alpha { vec(prior.n_clusters) },
   rho { umat(prior.n_items, prior.n_clusters) },
-  tau { normalise(Rcpp::as<vec>(Rcpp::rgamma(prior.n_clusters, prior.cluster_concentration, 1)), 1) }
+  tau { vec(prior.n_clusters) }
   {
+    alpha.imbue([&prior](){ return random_gamma(prior.alpha_shape, 1 / prior.alpha_rate); });
+    tau.imbue([&prior](){ return random_gamma(prior.cluster_concentration, 1); });
+    tau = normalise(tau, 1);
     rho.each_col([&prior](uvec& a){
-      a = Rcpp::as<uvec>(Rcpp::sample(prior.n_items, prior.n_items, false));
+      a = random_permutation(prior.n_items) + 1;
       });
   }
 
 Particle::Particle(const Options& options, const StaticParameters& parameters,
                    const std::unique_ptr<PartitionFunction>& pfun) :
+  Particle(options, parameters, compute_logz(parameters.alpha, pfun)) {}
+
+Particle::Particle(const Options& options, const StaticParameters& parameters,
+                   const vec& logz) :
   parameters { parameters },
   particle_filters(create_particle_filters(options)),
   log_normalized_particle_filter_weights (
-      Rcpp::NumericVector(options.n_particle_filters, -log(options.n_particle_filters))
-  ){
-    logz = zeros(parameters.tau.size());
-    for(size_t i{}; i < logz.size(); i++) {
-      logz(i) = pfun->logz(parameters.alpha(i));
-    }
+      vec(options.n_particle_filters, fill::value(-log(options.n_particle_filters)))
+  ),
+  logz { logz } {
+    auxiliary.enabled = options.pseudo_marginal_correlation > 0;
   }
 
+vec compute_logz(const vec& alpha, const std::unique_ptr<PartitionFunction>& pfun) {
+  vec logz(alpha.size());
+  for(size_t i{}; i < logz.size(); i++) {
+    logz(i) = pfun->logz(alpha(i));
+  }
+  return logz;
+}
+
 void Particle::run_particle_filter(
     unsigned int t, const Prior& prior,
     const std::unique_ptr<Data>& data,
@@ -40,23 +54,73 @@ void Particle::run_particle_filter(
     const std::unique_ptr<Distance>& distfun,
     const std::unique_ptr<Resampler>& resampler,
     std::string latent_rank_proposal,
-    bool conditional) {
+    bool conditional,
+    bool ancestor_sampling) {
 
-  if(t > 0) {
+  // With ancestor sampling, the reference trajectory is continued from a
+  // history drawn from the current weights rather than from its own history.
+  // The latent rankings at different timepoints are independent given the
+  // static parameters, so the ancestor weights are the filter weights.
+  ParticleFilter ancestor{};
+  if(t > 0 && conditional && ancestor_sampling) {
+    ancestor = particle_filters[random_index(exp(log_normalized_particle_filter_weights))];
+  }
+
+  if(t > 0 && auxiliary.enabled) {
+    // Systematic resampling of the particle filters sorted by weight, so that
+    // the resampled filters change little when the auxiliary variable does.
+    // In the conditional filter the reference trajectory stays first.
+    uvec order = sort_index(log_normalized_particle_filter_weights);
+    if(conditional) order = join_cols(uvec{0}, order(find(order != 0)));
+    std::vector<ParticleFilter> sorted_filters;
+    sorted_filters.reserve(order.n_elem);
+    for(auto i : order) sorted_filters.push_back(std::move(particle_filters[i]));
+
+    ivec new_counts = systematic_counts(
+      conditional ? order.n_elem - 1 : order.n_elem,
+      exp(log_normalized_particle_filter_weights(order)),
+      auxiliary.resampling_uniform(t));
+    if(conditional) new_counts(0) += 1;
+    particle_filters = update_vector(new_counts, sorted_filters, resampler->copied_bytes);
+  } else if(t > 0) {
     ivec new_counts = resampler->resample(
       conditional ? particle_filters.size() - 1 : particle_filters.size(),
       exp(log_normalized_particle_filter_weights));
     if(conditional) new_counts(0) += 1;
-    particle_filters = update_vector(new_counts, particle_filters);
+    particle_filters = update_vector(new_counts, particle_filters, resampler->copied_bytes);
   }
+  if(t > 0 && conditional && ancestor_sampling) particle_filters[0] = std::move(ancestor);
 
-  unsigned int pf_index{};
-  for(auto& pf : particle_filters) {
-    auto proposal = sample_latent_rankings(
-      data, t, prior, latent_rank_proposal, parameters, pfun, distfun);
+  // The latent rankings the conditioned filter is held to, widened once per
+  // timepoint for the distance functions.
+  umat conditioned_rankings;
+  if(conditional && ancestor_sampling) {
+    uword first = n_latent_columns(particle_filters[0]);
+    conditioned_rankings = conv_to<umat>::from(
+      reference.latent_rankings.cols(first, first + data->n_users(t) - 1));
+  } else if(conditional) {
+    conditioned_rankings = conv_to<umat>::from(particle_filters[0].latent_rankings.col(t));
+  }
+
+  // The particle filters are independent given the resampled histories, and
+  // are propagated as separate tasks.
+  if(auxiliary.enabled) auxiliary.allocate(t, particle_filters.size());
+  parallel_for(particle_filters.size(), [&](size_t s) {
+    ParticleFilter& pf = particle_filters[s];
+    unsigned int pf_index = s;
+    auto proposal = auxiliary.enabled ?
+      sample_latent_rankings(data, t, prior, latent_rank_proposal, parameters,
+                             pfun, distfun, *auxiliary.latent_source(t, pf_index)) :
+      sample_latent_rankings(data, t, prior, latent_rank_proposal, parameters,
+                             pfun, distfun);
 
     if(conditional && pf_index == 0) {
-      proposal.proposal = particle_filters[0].latent_rankings.col(t);
+      proposal.proposal = conditioned_rankings;
+      if(ancestor_sampling && prior.n_clusters > 1) {
+        uword first = n_latent_columns(pf);
+        proposal.cluster_assignment =
+          reference.cluster_assignments.subvec(first, first + proposal.proposal.n_cols - 1);
+      }
     }
 
     double log_prob{};
@@ -70,23 +134,18 @@ void Particle::run_particle_filter(
       log_prob += log_sum_exp(log_cluster_contribution);
     }
 
-    pf.cluster_probabilities = join_horiz(
-      pf.cluster_probabilities, proposal.cluster_probabilities
-    );
-
-    if(!(conditional && pf_index == 0)) {
+    if(!(conditional && pf_index == 0 && !ancestor_sampling)) {
       if(prior.n_clusters > 1) {
         pf.index = join_cols(pf.index, uvec{pf_index});
         pf.cluster_assignments =
           join_cols(pf.cluster_assignments, proposal.cluster_assignment);
       }
-      pf.latent_rankings = join_horiz(pf.latent_rankings, proposal.proposal);
+      append_latent_rankings(pf.latent_rankings, proposal.proposal);
     }
 
     pf.log_weight.resize(t + 1);
     pf.log_weight(t) = log_prob - sum(proposal.log_probability);
-    pf_index++;
-  }
+  });
 
   vec log_pf_weights(log_normalized_particle_filter_weights.size());
   std::transform(
@@ -96,11 +155,37 @@ void Particle::run_particle_filter(
   log_incremental_likelihood.resize(log_incremental_likelihood.size() + 1);
   log_incremental_likelihood(log_incremental_likelihood.size() - 1) = log_mean_exp(log_pf_weights);
   log_normalized_particle_filter_weights = softmax(log_pf_weights);
+  weight_variance_sum +=
+    log_pf_weights.n_elem * accu(exp(2 * log_normalized_particle_filter_weights)) - 1;
 }
 
 void Particle::sample_particle_filter() {
-  Rcpp::NumericVector probs = Rcpp::exp(log_normalized_particle_filter_weights);
-  conditioned_particle_filter = Rcpp::sample(probs.size(), 1, false, probs, false)[0];
+  conditioned_particle_filter = random_index(exp(log_normalized_particle_filter_weights));
+}
+
+// Changing the number of particle filters by resampling them would leave a
+// likelihood estimate which the stored auxiliary variables did not generate,
+// so with the correlated pseudo-marginal move the filters are instead run
+// afresh, with new auxiliary variables. As in the exchange step of SMC2, the
+// importance weight is then multiplied by the ratio of the estimates.
+double Particle::rerun_particle_filters(
+    unsigned int T, unsigned int n_filters, const Options& options, const Prior& prior,
+    const std::unique_ptr<Data>& data,
+    const std::unique_ptr<PartitionFunction>& pfun,
+    const std::unique_ptr<Distance>& distfun,
+    const std::unique_ptr<Resampler>& resampler
+) {
+  Options rerun_options = options;
+  rerun_options.n_particle_filters = n_filters;
+  Particle rerun(rerun_options, parameters, logz);
+  for(size_t t{}; t < T + 1; t++) {
+    rerun.run_particle_filter(t, prior, data, pfun, distfun, resampler, options.latent_rank_proposal);
+  }
+  rerun.sample_particle_filter();
+
+  double log_ratio = compute_log_Z(rerun.particle_filters, T) - compute_log_Z(particle_filters, T);
+  *this = std::move(rerun);
+  return log_ratio;
 }
 
 std::vector<Particle> create_particle_vector(const Options& options, const Prior& prior,
@@ -125,35 +210,33 @@ std::vector<ParticleFilter> create_particle_filters(const Options& options) {
   return result;
 }
 
-vec normalize_log_importance_weights(const std::vector<Particle>& particle_vector) {
-  vec log_importance_weights(particle_vector.size());
-  std::transform(
-    particle_vector.cbegin(), particle_vector.cend(),
-    log_importance_weights.begin(),
-    [](const Particle& p) { return p.log_importance_weight; });
+ParticlePopulation::ParticlePopulation(const std::vector<Particle>& particle_vector) :
+  alpha(particle_vector[0].parameters.alpha.n_elem, particle_vector.size()),
+  rho(particle_vector[0].parameters.rho.n_rows, particle_vector[0].parameters.rho.n_cols,
+      particle_vector.size()),
+  tau(particle_vector[0].parameters.tau.n_elem, particle_vector.size()) {
+  for(size_t i{}; i < particle_vector.size(); i++) {
+    const StaticParameters& parameters = particle_vector[i].parameters;
+    alpha.col(i) = parameters.alpha;
+    rho.slice(i) = parameters.rho;
+    tau.col(i) = parameters.tau;
+  }
+}
 
+vec normalize_log_importance_weights(const vec& log_importance_weights) {
   return softmax(log_importance_weights);
 }
 
-  double log_marginal_likelihood_increment(
-      const std::vector<Particle>& particle_vector,
-      const vec& normalized_log_importance_weights,
-      int t
-  ) {
-  vec unconditional_log_incremental(particle_vector.size());
+vec log_incremental_likelihoods(const std::vector<Particle>& particle_vector, unsigned int t) {
+  vec result(particle_vector.size());
   for(size_t i{}; i < particle_vector.size(); i++) {
-    unconditional_log_incremental(i) =
-      normalized_log_importance_weights(i) + particle_vector[i].log_incremental_likelihood(t);
+    result(i) = particle_vector[i].log_incremental_likelihood(t);
   }
-  return log_sum_exp(unconditional_log_incremental);
+  return result;
 }
 
-vec compute_alpha_stddev(const std::vector<Particle>& particle_vector) {
-  mat alpha_values(particle_vector.size(), particle_vector[0].parameters.alpha.size());
-  for(size_t i{}; i < particle_vector.size(); i++) {
-    alpha_values.row(i) = particle_vector[i].parameters.alpha.t();
-  }
-  return stddev(alpha_values, 0, 0).t();
+vec compute_alpha_stddev(const ParticlePopulation& population) {
+  return stddev(population.alpha, 0, 1);
 }
 
 double compute_log_Z(const std::vector<ParticleFilter>& pf, int max_time) {
@@ -167,3 +250,84 @@ double compute_log_Z(const std::vector<ParticleFilter>& pf, int max_time) {
   }
   return log_Z;
 }
+
+// Cluster probabilities of each latent ranking of the conditioned particle
+// filter given the current parameters, with one column per user. They are
+// computed when the results are returned rather than stored while running.
+mat compute_cluster_probabilities(const Particle& p, const std::unique_ptr<Distance>& distfun) {
+  const StaticParameters& parameters = p.parameters;
+  umat latent_rankings = conv_to<umat>::from(
+    all_latent_rankings(p.particle_filters[p.conditioned_particle_filter]));
+  mat result(parameters.tau.size(), latent_rankings.n_cols);
+  for(size_t i{}; i < latent_rankings.n_cols; i++) {
+    vec log_cluster_probabilities(parameters.tau.size());
+    for(size_t c{}; c < parameters.tau.size(); c++) {
+      log_cluster_probabilities(c) = log(parameters.tau(c)) - p.logz(c) -
+        parameters.alpha(c) * distfun->d(latent_rankings.col(i), parameters.rho.col(c));
+    }
+    result.col(i) = exp(softmax(log_cluster_probabilities));
+  }
+  return result;
+}
+
+uword n_latent_columns(const ParticleFilter& pf) {
+  uword result = pf.latent_rankings.n_cols;
+  for(const auto& block : pf.spilled_latent_rankings) result += block.n_cols;
+  return result;
+}
+
+// The latent rankings at all timepoints, reading the spilled columns back
+// from the scratch file in order.
+rank_mat all_latent_rankings(const ParticleFilter& pf) {
+  if(pf.spilled_latent_rankings.empty()) return pf.latent_rankings;
+  rank_mat result(pf.latent_rankings.n_rows, n_latent_columns(pf));
+  uword column{};
+  for(const auto& block : pf.spilled_latent_rankings) {
+    result.cols(column, column + block.n_cols - 1) =
+      block.file->read(block.offset, block.n_rows, block.n_cols);
+    column += block.n_cols;
+  }
+  if(!pf.latent_rankings.is_empty()) result.tail_cols(pf.latent_rankings.n_cols) = pf.latent_rankings;
+  return result;
+}
+
+// Narrows the new columns straight into the grown matrix, without a converted
+// temporary per particle filter.
+void append_latent_rankings(rank_mat& latent_rankings, const umat& rankings) {
+  if(rankings.is_empty()) return;
+  uword n_cols = latent_rankings.n_cols;
+  latent_rankings.resize(rankings.n_rows, n_cols + rankings.n_cols);
+  std::copy(rankings.begin(), rankings.end(), latent_rankings.begin_col(n_cols));
+}
+
+void restore_latent_rankings(ParticleFilter& pf) {
+  if(pf.spilled_latent_rankings.empty()) return;
+  pf.latent_rankings = all_latent_rankings(pf);
+  pf.spilled_latent_rankings.clear();
+}
+
+void spill_latent_rankings(ParticleFilter& pf, const std::shared_ptr<SpillFile>& file) {
+  if(pf.latent_rankings.is_empty()) return;
+  pf.spilled_latent_rankings.push_back(SpilledBlock{
+    file, file->write(pf.latent_rankings), pf.latent_rankings.n_rows, pf.latent_rankings.n_cols
+  });
+  pf.latent_rankings.reset();
+}
+
+size_t memory_size(const ParticleFilter& pf) {
+  return sizeof(ParticleFilter) +
+    pf.latent_rankings.n_elem * sizeof(rank_t) +
+    (pf.cluster_assignments.n_elem + pf.index.n_elem) * sizeof(uword) +
+    pf.log_weight.n_elem * sizeof(double) +
+    pf.spilled_latent_rankings.size() * sizeof(SpilledBlock);
+}
+
+size_t memory_size(const Particle& p) {
+  size_t result = sizeof(Particle) + p.parameters.rho.n_elem * sizeof(uword) +
+    (p.parameters.alpha.n_elem + p.parameters.tau.n_elem + p.logz.n_elem +
+    p.log_incremental_likelihood.n_elem +
+    p.log_normalized_particle_filter_weights.n_elem) * sizeof(double) +
+    memory_size(p.auxiliary);
+  for(const auto& pf : p.particle_filters) result += memory_size(pf);
+  return result;
+}
@@ -1,12 +1,18 @@
 #pragma once
-#include <RcppArmadillo.h>
+#include <memory>
+#include <string>
 #include <vector>
+#include "arma.h"
+#include "auxiliary_variables.h"
 #include "prior.h"
+#include "proposal_tuning.h"
 #include "data.h"
 #include "options.h"
 #include "partition_functions.h"
 #include "distances.h"
 #include "resampler.h"
+#include "rho_proposals.h"
+#include "spill_file.h"
 
 struct StaticParameters{
   StaticParameters() {}
@@ -20,53 +26,107 @@ struct StaticParameters{
 struct ParticleFilter{
   ParticleFilter() {}
   ~ParticleFilter() = default;
-  arma::umat latent_rankings{};
+  rank_mat latent_rankings{};
   arma::uvec cluster_assignments{};
   arma::vec log_weight{};
   arma::uvec index{};
-  arma::mat cluster_probabilities{};
+  // Leading columns of the latent rankings moved to a scratch file, in order.
+  // latent_rankings holds the columns after them.
+  std::vector<SpilledBlock> spilled_latent_rankings{};
 };
 
+// Outcome of a rejuvenation move. With delayed acceptance, a proposal can be
+// rejected by the cheap screen before the full particle filter is run.
+enum class MoveOutcome { rejected, accepted, screened_out };
+
 struct Particle{
   Particle() {}
   Particle(const Options& options, const StaticParameters& parameters,
            const std::unique_ptr<PartitionFunction>& pfun);
+  // Uses the given log partition functions instead of computing them.
+  Particle(const Options& options, const StaticParameters& parameters,
+           const arma::vec& logz);
   ~Particle() = default;
   StaticParameters parameters;
   std::vector<ParticleFilter> particle_filters;
-  double log_importance_weight{};
   arma::vec log_incremental_likelihood{};
-  Rcpp::NumericVector log_normalized_particle_filter_weights;
+  arma::vec log_normalized_particle_filter_weights{};
+  // Running sum over timepoints of the squared coefficient of variation of the
+  // particle filter weights. Divided by the number of particle filters, it
+  // estimates the variance of the log-likelihood estimate.
+  double weight_variance_sum{};
   void run_particle_filter(
       unsigned int t, const Prior& prior, const std::unique_ptr<Data>& data,
       const std::unique_ptr<PartitionFunction>& pfun,
       const std::unique_ptr<Distance>& distfun,
       const std::unique_ptr<Resampler>& resampler,
       std::string latent_rank_proposal,
-      bool conditional = false);
-  bool rejuvenate(
+      bool conditional = false,
+      bool ancestor_sampling = false);
+  MoveOutcome rejuvenate(
     unsigned int T, const Options& options, const Prior& prior,
     const std::unique_ptr<Data>& data,
     const std::unique_ptr<PartitionFunction>& pfun,
     const std::unique_ptr<Distance>& distfun,
     const std::unique_ptr<Resampler>& resampler,
-    const arma::vec& alpha_sd
+    const std::unique_ptr<RhoProposal>& rho_kernel,
+    const arma::vec& alpha_sd,
+    ProposalTuning& tuning,
+    double exponent = 1
+  );
+  void update_tau(
+    unsigned int T, const Options& options, const Prior& prior,
+    const std::unique_ptr<Data>& data,
+    const std::unique_ptr<PartitionFunction>& pfun,
+    const std::unique_ptr<Distance>& distfun,
+    const std::unique_ptr<Resampler>& resampler
+  );
+  // Replaces the particle filters by n_filters new ones run up to timepoint T,
+  // and returns the change in the log-likelihood estimate.
+  double rerun_particle_filters(
+    unsigned int T, unsigned int n_filters, const Options& options, const Prior& prior,
+    const std::unique_ptr<Data>& data,
+    const std::unique_ptr<PartitionFunction>& pfun,
+    const std::unique_ptr<Distance>& distfun,
+    const std::unique_ptr<Resampler>& resampler
   );
   int conditioned_particle_filter{};
   void sample_particle_filter();
   arma::vec logz{};
+  AuxiliaryVariables auxiliary{};
+  // Reference trajectory of the conditional particle filter with ancestor
+  // sampling. Empty otherwise.
+  ParticleFilter reference{};
+};
+
+// The static parameters of all particles gathered into contiguous blocks, with
+// one column or slice per particle, so that reductions over the population
+// run over contiguous memory rather than one particle at a time.
+struct ParticlePopulation{
+  explicit ParticlePopulation(const std::vector<Particle>& particle_vector);
+  arma::mat alpha;
+  arma::ucube rho;
+  arma::mat tau;
 };
 
 std::vector<Particle> create_particle_vector(const Options& options, const Prior& prior,
                                              const std::unique_ptr<PartitionFunction>& pfun);
 std::vector<ParticleFilter> create_particle_filters(const Options& options);
-arma::vec normalize_log_importance_weights(const std::vector<Particle>& particle_vector);
-double log_marginal_likelihood_increment(
-    const std::vector<Particle>& particle_vector,
-    const arma::vec& normalized_log_importance_weights,
-    int t
-);
-arma::vec compute_alpha_stddev(const std::vector<Particle>& particle_vector);
-int find_unique_alphas(const std::vector<Particle>& particle_vector);
+arma::vec normalize_log_importance_weights(const arma::vec& log_importance_weights);
+arma::vec log_incremental_likelihoods(const std::vector<Particle>& particle_vector,
+                                      unsigned int t);
+arma::vec compute_alpha_stddev(const ParticlePopulation& population);
+int find_unique_alphas(const ParticlePopulation& population);
+int find_unique_rhos(const ParticlePopulation& population);
 
+arma::vec compute_logz(const arma::vec& alpha, const std::unique_ptr<PartitionFunction>& pfun);
 double compute_log_Z(const std::vector<ParticleFilter>& pf, int max_time);
+arma::mat compute_cluster_probabilities(const Particle& p,
+                                        const std::unique_ptr<Distance>& distfun);
+arma::uword n_latent_columns(const ParticleFilter& pf);
+rank_mat all_latent_rankings(const ParticleFilter& pf);
+void append_latent_rankings(rank_mat& latent_rankings, const arma::umat& rankings);
+void restore_latent_rankings(ParticleFilter& pf);
+void spill_latent_rankings(ParticleFilter& pf, const std::shared_ptr<SpillFile>& file);
+size_t memory_size(const ParticleFilter& pf);
+size_t memory_size(const Particle& p);
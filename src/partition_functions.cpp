@@ -1,10 +1,10 @@
-#include "partition_functions.h"
+#include <stdexcept>
 #include <string>
-#include <RcppArmadillo.h>
+#include "partition_functions.h"
 using namespace arma;
 
 std::unique_ptr<PartitionFunction> choose_partition_function(
-    int n_items, std::string metric) {
+    int n_items, std::string metric, const std::string& cardinalities_dir) {
   if(metric == "cayley") {
     return std::make_unique<Cayley>(n_items);
   } else if(metric == "hamming") {
@@ -12,9 +12,9 @@ std::unique_ptr<PartitionFunction> choose_partition_function(
   } else if(metric == "kendall") {
     return std::make_unique<Kendall>(n_items);
   } else if(metric == "footrule" || metric == "spearman" || metric == "ulam") {
-    return std::make_unique<Cardinalities>(n_items, metric);
+    return std::make_unique<Cardinalities>(n_items, metric, cardinalities_dir);
   } else {
-    Rcpp::stop("Unknown metric.");
+    throw std::invalid_argument("Unknown metric.");
   }
 }
 
@@ -49,18 +49,18 @@ double Kendall::logz(double alpha) {
   return res;
 }
 
-Cardinalities::Cardinalities(unsigned int n_items, const std::string& metric) :
-  n_items { n_items } {
-  mat tmp;
-    Rcpp::Function f("system.file");
-    Rcpp::List pkg_path = f(Rcpp::Named("package") = "BayesMallowsSMC2");
+Cardinalities::Cardinalities(const vec& distances, const vec& cardinalities) :
+  distances { distances }, cardinalities { cardinalities } {}
 
-  std::string filename = std::string(pkg_path[0]) + std::string("/partition_function_data/") +
+Cardinalities::Cardinalities(unsigned int n_items, const std::string& metric,
+                             const std::string& cardinalities_dir) {
+  mat tmp;
+  std::string filename = cardinalities_dir + std::string("/") +
     metric + std::string("_") + std::to_string(n_items) + std::string("items.csv");
 
   bool ok = tmp.load(filename);
   if(ok == false) {
-    Rcpp::stop("Could not find partition function.");
+    throw std::runtime_error("Could not find partition function.");
   }
 
   distances = tmp.col(0);
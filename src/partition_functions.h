@@ -1,7 +1,8 @@
 #pragma once
 
 #include <memory>
-#include <RcppArmadillo.h>
+#include <string>
+#include "arma.h"
 
 struct PartitionFunction {
   PartitionFunction() {};
@@ -9,7 +10,10 @@ struct PartitionFunction {
   virtual double logz(double alpha) = 0;
 };
 
-std::unique_ptr<PartitionFunction> choose_partition_function(int n_items, std::string metric);
+// Partition functions for footrule, Spearman and Ulam distance are computed
+// from precomputed cardinalities, stored as CSV files in cardinalities_dir.
+std::unique_ptr<PartitionFunction> choose_partition_function(
+    int n_items, std::string metric, const std::string& cardinalities_dir);
 
 struct Cayley : PartitionFunction {
   Cayley(unsigned int n_items);
@@ -30,9 +34,10 @@ struct Kendall : PartitionFunction {
 };
 
 struct Cardinalities : PartitionFunction {
-  Cardinalities(unsigned int n_items, const std::string& metric);
+  Cardinalities(const arma::vec& distances, const arma::vec& cardinalities);
+  Cardinalities(unsigned int n_items, const std::string& metric,
+                const std::string& cardinalities_dir);
   double logz(double alpha) override;
-  const unsigned int n_items;
   arma::vec distances;
   arma::vec cardinalities;
 };
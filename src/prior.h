@@ -1,12 +1,9 @@
 #pragma once
-#include <Rcpp.h>
 
 struct Prior{
-  Prior(const Rcpp::List& input_prior);
-  ~Prior() = default;
-  double alpha_shape;
-  double alpha_rate;
-  int cluster_concentration;
-  int n_clusters;
-  int n_items;
+  double alpha_shape{1};
+  double alpha_rate{.5};
+  int cluster_concentration{10};
+  int n_clusters{1};
+  int n_items{};
 };
@@ -1,42 +1,65 @@
-#include <RcppArmadillo.h>
 #include "progress_reporter.h"
 
-ProgressReporter::ProgressReporter(const bool verbose) :
-  verbose { verbose } {}
+ProgressReporter::ProgressReporter(const bool verbose, std::ostream& out) :
+  verbose { verbose }, out { out } {}
 
 void ProgressReporter::report_time(size_t t) {
   if(verbose){
-    Rcpp::Rcout << "t = " << t << std::endl;
+    out << "t = " << t << std::endl;
   }
 }
 
 void ProgressReporter::report_ess(double ess) {
   if(verbose) {
-    Rcpp::Rcout << "effective sample size = " << ess << std::endl;
+    out << "effective sample size = " << ess << std::endl;
   }
 }
 
 void ProgressReporter::report_resampling() {
   if(verbose) {
-    Rcpp::Rcout << "starting resampling" << std::endl;
+    out << "starting resampling" << std::endl;
+  }
+}
+
+void ProgressReporter::report_tempering(double exponent) {
+  if(verbose) {
+    out << "tempering exponent = " << exponent << std::endl;
   }
 }
 
 void ProgressReporter::report_rejuvenation(int unique_particles) {
   if(verbose) {
-    Rcpp::Rcout << unique_particles << " unique particles after rejuvenation" << std::endl;
+    out << unique_particles << " unique particles after rejuvenation" << std::endl;
   }
 }
 
 void ProgressReporter::report_expansion(int n_particle_filters) {
   if(verbose) {
-    Rcpp::Rcout << n_particle_filters << " particle filters after doubling" << std::endl;
+    out << n_particle_filters << " particle filters after doubling" << std::endl;
+  }
+}
+
+void ProgressReporter::report_resize(int n_particle_filters) {
+  if(verbose) {
+    out << n_particle_filters << " particle filters after adaptation" << std::endl;
+  }
+}
+
+void ProgressReporter::report_population_size(int n_particles) {
+  if(verbose) {
+    out << n_particles << " particles after adaptation" << std::endl;
+  }
+}
+
+void ProgressReporter::report_memory(double bytes) {
+  if(verbose) {
+    out << "estimated memory for the particles = " << bytes / (1 << 20) << " MB" << std::endl;
   }
 }
 
 void ProgressReporter::report_acceptance_rate(double acceptance_rate) {
   if(verbose) {
-    Rcpp::Rcout << "Acceptance rate " << acceptance_rate
+    out << "Acceptance rate " << acceptance_rate
                 << " in rejuvenation step." << std::endl;
   }
 }
@@ -1,15 +1,21 @@
 #pragma once
-#include "options.h"
+#include <cstddef>
+#include <ostream>
 
 struct ProgressReporter{
-  ProgressReporter(const bool verbose);
+  ProgressReporter(const bool verbose, std::ostream& out);
   void report_time(size_t t);
   void report_ess(double ess);
   void report_resampling();
+  void report_tempering(double exponent);
   void report_rejuvenation(int unique_particles);
   void report_expansion(int n_particle_filters);
+  void report_resize(int n_particle_filters);
+  void report_population_size(int n_particles);
+  void report_memory(double bytes);
   void report_acceptance_rate(double acceptance_rate);
 
 private:
   const bool verbose;
+  std::ostream& out;
 };
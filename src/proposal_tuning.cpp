@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "proposal_tuning.h"
+#include "random.h"
+
+using namespace arma;
+
+namespace {
+// Share of the leap size distribution spread uniformly, so that every leap
+// size keeps being proposed.
+const double leap_exploration{.1};
+}
+
+ProposalTuning::ProposalTuning(bool enabled, const Prior& prior, unsigned int n_timepoints) :
+  enabled { enabled },
+  alpha_scale { ones(prior.n_clusters) },
+  leap_probabilities { zeros(std::max(1, prior.n_items / 2)) },
+  alpha_scale_history { zeros(n_timepoints, prior.n_clusters) },
+  leap_probabilities_history { zeros(n_timepoints, leap_probabilities.size()) },
+  alpha_step_weight { zeros(prior.n_clusters) },
+  alpha_accepted_weight { zeros(prior.n_clusters) },
+  leap_proposed { zeros(leap_probabilities.size()) },
+  leap_accepted { zeros(leap_probabilities.size()) } {
+  leap_probabilities.fill(leap_exploration / leap_probabilities.size());
+  leap_probabilities(0) += 1 - leap_exploration;
+}
+
+void ProposalTuning::resize(unsigned int n_timepoints) {
+  alpha_scale_history.resize(n_timepoints, alpha_scale.size());
+  leap_probabilities_history.resize(n_timepoints, leap_probabilities.size());
+}
+
+unsigned int ProposalTuning::draw_leap_size() const {
+  if(!enabled) return 1;
+  return random_index(leap_probabilities) + 1;
+}
+
+void ProposalTuning::record(const vec& alpha_steps, const uvec& leap_sizes, bool accepted) {
+  if(!enabled) return;
+  vec weight = square(alpha_steps);
+  // Particles may be rejuvenated in parallel.
+#pragma omp critical(proposal_tuning_record)
+  {
+    alpha_step_weight += weight;
+    if(accepted) alpha_accepted_weight += weight;
+    for(auto leap_size : leap_sizes) {
+      // Clusters left out of a blocked move have leap size zero
+      if(leap_size == 0) continue;
+      leap_proposed(leap_size - 1)++;
+      if(accepted) leap_accepted(leap_size - 1)++;
+    }
+  }
+}
+
+void ProposalTuning::adapt() {
+  if(!enabled) return;
+
+  // The acceptance rate of each cluster weights the proposals by the squared
+  // size of their alpha step in that cluster, so that clusters whose large
+  // steps are rejected get smaller scales.
+  for(size_t cluster{}; cluster < alpha_scale.size(); cluster++) {
+    if(alpha_step_weight(cluster) == 0) continue;
+    double rate = alpha_accepted_weight(cluster) / alpha_step_weight(cluster);
+    alpha_scale(cluster) = std::clamp(
+      alpha_scale(cluster) * std::exp(rate - target_acceptance), .01, 100.0);
+  }
+
+  // Leap sizes are weighted by their expected jump, the leap size times its
+  // acceptance rate, shrunk towards the target acceptance.
+  vec rates = (leap_accepted + target_acceptance) / (leap_proposed + 1);
+  vec expected_jump = rates % regspace(1, leap_probabilities.size());
+  leap_probabilities = (1 - leap_exploration) * normalise(expected_jump, 1) +
+    leap_exploration / leap_probabilities.size();
+
+  alpha_step_weight.zeros();
+  alpha_accepted_weight.zeros();
+  leap_proposed.zeros();
+  leap_accepted.zeros();
+}
+
+void ProposalTuning::update_history(unsigned int t) {
+  if(!enabled) return;
+  alpha_scale_history.row(t) = alpha_scale.t();
+  leap_probabilities_history.row(t) = leap_probabilities.t();
+}
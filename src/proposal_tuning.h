@@ -0,0 +1,34 @@
+#pragma once
+#include "arma.h"
+#include "prior.h"
+
+// Scales of the alpha proposals and distribution of the leap sizes of the rho
+// proposals in the rejuvenation. When enabled, they are adapted between
+// sweeps from the acceptance statistics of the previous sweep. The values are
+// fixed within a sweep, so each sweep leaves the posterior invariant.
+struct ProposalTuning {
+  ProposalTuning(bool enabled, const Prior& prior, unsigned int n_timepoints);
+  void resize(unsigned int n_timepoints);
+  const bool enabled;
+  double target_acceptance{.234};
+  // Multiplies the population standard deviation of alpha in each cluster.
+  arma::vec alpha_scale;
+  // Probabilities of leap sizes 1, 2, ..., up to half the number of items.
+  arma::vec leap_probabilities;
+  // Values in effect at the end of each timepoint.
+  arma::mat alpha_scale_history;
+  arma::mat leap_probabilities_history;
+
+  unsigned int draw_leap_size() const;
+  // Statistics of one proposal, given the standardized alpha steps and the
+  // leap size in each cluster, which is zero for clusters that were not
+  // updated.
+  void record(const arma::vec& alpha_steps, const arma::uvec& leap_sizes, bool accepted);
+  void adapt();
+  void update_history(unsigned int t);
+
+  arma::vec alpha_step_weight;
+  arma::vec alpha_accepted_weight;
+  arma::vec leap_proposed;
+  arma::vec leap_accepted;
+};
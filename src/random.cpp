@@ -0,0 +1,111 @@
+#include "random.h"
+
+using namespace arma;
+
+RandomSource& default_random_source() {
+  static RandomSource source{};
+  return source;
+}
+
+#ifdef BAYESMALLOWSSMC2_STANDALONE
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+std::mt19937_64& random_engine() {
+  thread_local std::mt19937_64 engine{std::random_device{}()};
+  return engine;
+}
+
+void set_random_seed(unsigned long long seed) {
+  random_engine().seed(seed);
+}
+
+double random_uniform() {
+  return std::uniform_real_distribution<double>(0, 1)(random_engine());
+}
+
+double random_gamma(double shape, double scale) {
+  return std::gamma_distribution<double>(shape, scale)(random_engine());
+}
+
+double random_lognormal(double meanlog, double sdlog) {
+  return std::lognormal_distribution<double>(meanlog, sdlog)(random_engine());
+}
+
+double random_normal() {
+  return std::normal_distribution<double>(0, 1)(random_engine());
+}
+
+unsigned int random_index(unsigned int n) {
+  return std::uniform_int_distribution<unsigned int>(0, n - 1)(random_engine());
+}
+
+unsigned int random_index(const vec& probs) {
+  return std::discrete_distribution<unsigned int>(
+    probs.begin(), probs.end())(random_engine());
+}
+
+uvec random_permutation(unsigned int n) {
+  uvec result(n);
+  std::iota(result.begin(), result.end(), 0);
+  std::shuffle(result.begin(), result.end(), random_engine());
+  return result;
+}
+
+ivec random_multinomial(unsigned int size, const vec& probs) {
+  ivec outcome = zeros<ivec>(probs.size());
+  double remaining_mass = accu(probs);
+  int remaining = size;
+  for(size_t i{}; i < probs.size() && remaining > 0; i++) {
+    if(i == probs.size() - 1 || remaining_mass <= probs(i)) {
+      outcome(i) = remaining;
+      break;
+    }
+    outcome(i) = std::binomial_distribution<int>(
+      remaining, std::min(1.0, probs(i) / remaining_mass))(random_engine());
+    remaining -= outcome(i);
+    remaining_mass -= probs(i);
+  }
+  return outcome;
+}
+
+#else
+
+double random_uniform() {
+  return R::runif(0, 1);
+}
+
+double random_gamma(double shape, double scale) {
+  return R::rgamma(shape, scale);
+}
+
+double random_lognormal(double meanlog, double sdlog) {
+  return R::rlnorm(meanlog, sdlog);
+}
+
+double random_normal() {
+  return R::norm_rand();
+}
+
+unsigned int random_index(unsigned int n) {
+  return Rcpp::sample(n, 1, false)[0] - 1;
+}
+
+unsigned int random_index(const vec& probs) {
+  Rcpp::NumericVector p(probs.begin(), probs.end());
+  return Rcpp::sample(p.size(), 1, false, p, false)[0];
+}
+
+uvec random_permutation(unsigned int n) {
+  return Rcpp::as<uvec>(Rcpp::sample(n, n, false)) - 1;
+}
+
+ivec random_multinomial(unsigned int size, const vec& probs) {
+  vec p = probs;
+  ivec outcome = zeros<ivec>(p.size());
+  R::rmultinom(size, p.begin(), p.size(), outcome.begin());
+  return outcome;
+}
+
+#endif
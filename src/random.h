@@ -0,0 +1,31 @@
+#pragma once
+#include "arma.h"
+
+// Random number generation used by the engine. Within the R package all
+// draws come from R's generator, so that set.seed() gives reproducible
+// results. The standalone build uses a per-thread Mersenne twister instead.
+// set_random_seed() seeds the generator of the calling thread only, so runs
+// with options.n_threads > 1 are not reproducible.
+double random_uniform();
+double random_gamma(double shape, double scale);
+double random_lognormal(double meanlog, double sdlog);
+double random_normal();
+unsigned int random_index(unsigned int n);
+unsigned int random_index(const arma::vec& probs);
+arma::uvec random_permutation(unsigned int n);
+arma::ivec random_multinomial(unsigned int size, const arma::vec& probs);
+
+// Source of the random numbers used when sampling latent rankings in the
+// particle filter. The base class draws from the generator above, and is
+// overridden by the correlated pseudo-marginal move to replay stored variates.
+struct RandomSource {
+  virtual ~RandomSource() = default;
+  virtual unsigned int index(unsigned int n) { return random_index(n); }
+  virtual unsigned int index(const arma::vec& probs) { return random_index(probs); }
+  virtual arma::uvec permutation(unsigned int n) { return random_permutation(n); }
+};
+RandomSource& default_random_source();
+
+#ifdef BAYESMALLOWSSMC2_STANDALONE
+void set_random_seed(unsigned long long seed);
+#endif
@@ -0,0 +1,302 @@
+#include "rcpp_adapter.h"
+
+using namespace arma;
+
+Prior read_prior(const Rcpp::List& input_prior) {
+  Prior prior;
+  prior.alpha_shape = input_prior["alpha_shape"];
+  prior.alpha_rate = input_prior["alpha_rate"];
+  prior.cluster_concentration = input_prior["cluster_concentration"];
+  prior.n_clusters = input_prior["n_clusters"];
+  prior.n_items = input_prior["n_items"];
+  return prior;
+}
+
+Options read_options(const Rcpp::List& input_options) {
+  Options options;
+  options.metric = Rcpp::as<std::string>(input_options["metric"]);
+  options.resampler = Rcpp::as<std::string>(input_options["resampler"]);
+  options.latent_rank_proposal = Rcpp::as<std::string>(input_options["latent_rank_proposal"]);
+  options.rho_proposal = Rcpp::as<std::string>(input_options["rho_proposal"]);
+  options.leap_size = input_options["leap_size"];
+  options.n_particles = input_options["n_particles"];
+  options.adaptive_particles = input_options["adaptive_particles"];
+  options.min_particles = input_options["min_particles"];
+  options.max_particles = input_options["max_particles"];
+  options.n_particle_filters = input_options["n_particle_filters"];
+  options.max_particle_filters = input_options["max_particle_filters"];
+  options.resampling_threshold = input_options["resampling_threshold"];
+  options.max_rejuvenation_steps = input_options["max_rejuvenation_steps"];
+  options.doubling_threshold = input_options["doubling_threshold"];
+  options.target_log_likelihood_variance = input_options["target_log_likelihood_variance"];
+  options.adaptive_tempering = input_options["adaptive_tempering"];
+  options.batch_size = input_options["batch_size"];
+  options.adaptive_batch_size = input_options["adaptive_batch_size"];
+  options.pseudo_marginal_correlation = input_options["pseudo_marginal_correlation"];
+  options.ancestor_sampling = input_options["ancestor_sampling"];
+  options.fuse_tau_update = input_options["fuse_tau_update"];
+  options.cluster_block_size = input_options["cluster_block_size"];
+  options.delayed_acceptance_filters = input_options["delayed_acceptance_filters"];
+  options.adaptive_proposals = input_options["adaptive_proposals"];
+  options.verbose = input_options["verbose"];
+  options.trace = input_options["trace"];
+  options.trace_latent = input_options["trace_latent"];
+  Rcpp::RObject trace_file = input_options["trace_file"];
+  if(!trace_file.isNULL()) options.trace_file = Rcpp::as<std::string>(trace_file);
+  Rcpp::RObject checkpoint_file = input_options["checkpoint_file"];
+  if(!checkpoint_file.isNULL()) options.checkpoint_file = Rcpp::as<std::string>(checkpoint_file);
+  options.memory_budget = input_options["memory_budget"];
+  Rcpp::RObject scratch_file = input_options["scratch_file"];
+  if(!scratch_file.isNULL()) options.scratch_file = Rcpp::as<std::string>(scratch_file);
+  options.checkpoint_interval = input_options["checkpoint_interval"];
+  options.instrument = input_options["instrument"];
+  options.time_limit = input_options["time_limit"];
+  options.diagnostics = input_options["diagnostics"];
+  return options;
+}
+
+ranking_ts read_rankings(const Rcpp::List& input_timeseries) {
+  ranking_ts timeseries;
+  timeseries.reserve(input_timeseries.size());
+  for(Rcpp::List a : input_timeseries) {
+    ranking_tp new_data;
+    Rcpp::CharacterVector nm = a.names();
+    for(size_t i{}; i < nm.size(); i++) {
+      // 1. Read as Rcpp vector to safely check for NA
+      Rcpp::NumericVector r_vec = a[i];
+
+      // 2. Create a clean Armadillo vector, forcing NAs to 0
+      arma::uvec clean_vec(r_vec.size());
+      for(int j = 0; j < r_vec.size(); ++j) {
+        if (Rcpp::NumericVector::is_na(r_vec[j])) {
+          clean_vec[j] = 0; // Explicitly mark as missing
+        } else {
+          clean_vec[j] = (unsigned int)r_vec[j];
+        }
+      }
+
+      // 3. Use the clean vector
+      new_data[std::string(nm[i])] = create_ranking_obs(clean_vec);
+    }
+    timeseries.push_back(new_data);
+  }
+  return timeseries;
+}
+
+pairwise_ts read_preferences(const Rcpp::List& input_timeseries) {
+  pairwise_ts timeseries;
+  timeseries.reserve(input_timeseries.size());
+
+  for(Rcpp::List a : input_timeseries) {
+    pairwise_tp new_data;
+    Rcpp::CharacterVector nm = a.names();
+    for(size_t i{}; i < nm.size(); i++) {
+      umat preferences = a[i];
+      comparisons user_data;
+      for(size_t j{}; j < preferences.n_rows; j++) {
+        user_data.insert(single_comparison(preferences(j, 0), preferences(j, 1)));
+      }
+      new_data[std::string(nm[i])] = user_data;
+    }
+    timeseries.push_back(new_data);
+  }
+  return timeseries;
+}
+
+sort_matrices_ts read_sort_matrices(const Rcpp::List& input_sort_matrices) {
+  sort_matrices_ts sort_matrix_timeseries;
+  sort_matrix_timeseries.reserve(input_sort_matrices.size());
+
+  for(Rcpp::List a : input_sort_matrices) {
+    sort_matrices_tp new_data;
+    Rcpp::CharacterVector nm = a.names();
+    for(size_t i{}; i < nm.size(); i++) {
+      umat sort_matrix = a[i];
+      new_data[std::string(nm[i])] = conv_to<rank_mat>::from(sort_matrix);
+    }
+    sort_matrix_timeseries.push_back(new_data);
+  }
+  return sort_matrix_timeseries;
+}
+
+sort_counts_ts read_sort_counts(const Rcpp::List& input_sort_counts) {
+  sort_counts_ts sort_count_timeseries;
+  sort_count_timeseries.reserve(input_sort_counts.size());
+  for(Rcpp::List a : input_sort_counts) {
+    sort_counts_tp new_data;
+    Rcpp::CharacterVector nm = a.names();
+    for(size_t i{}; i < nm.size(); i++) {
+      new_data[std::string(nm[i])] = a[i];
+    }
+    sort_count_timeseries.push_back(new_data);
+  }
+  return sort_count_timeseries;
+}
+
+std::unique_ptr<Data> read_data(
+    const Rcpp::List& input_timeseries,
+    const Rcpp::List& input_sort_matrices,
+    const Rcpp::List& input_sort_counts
+) {
+  std::string type = Rcpp::as<std::string>(input_timeseries.attr("type"));
+
+  if (type == "complete rankings" || type == "partial rankings") {
+    return std::make_unique<Rankings>(
+      read_rankings(input_timeseries), type == "partial rankings");
+  } else if (type == "pairwise preferences") {
+    return std::make_unique<PairwisePreferences>(
+      read_preferences(input_timeseries), read_sort_matrices(input_sort_matrices),
+      read_sort_counts(input_sort_counts)
+      );
+  } else {
+    Rcpp::stop("Wrong data type.");
+  }
+}
+
+std::string cardinalities_dir() {
+  Rcpp::Function f("system.file");
+  Rcpp::List pkg_path = f(Rcpp::Named("package") = "BayesMallowsSMC2");
+  return std::string(pkg_path[0]) + std::string("/partition_function_data");
+}
+
+void check_interrupt(void*) {
+  R_CheckUserInterrupt();
+}
+
+// Like Rcpp::checkUserInterrupt(), but returns true instead of throwing, so
+// that the sampler can stop at a safe point and return the results so far.
+bool r_interrupt_requested() {
+  return R_ToplevelExec(check_interrupt, nullptr) == FALSE;
+}
+
+Rcpp::RObject wrap_run_status(const RunStatus& status) {
+  return Rcpp::List::create(
+    Rcpp::Named("deadline_reached") = status.deadline_reached,
+    Rcpp::Named("interrupted") = status.interrupted,
+    Rcpp::Named("shortened_rejuvenations") = status.shortened_rejuvenations,
+    Rcpp::Named("skipped_timepoints") = status.skipped_timepoints,
+    Rcpp::Named("estimated_memory") = status.estimated_memory,
+    Rcpp::Named("spilled_bytes") = static_cast<double>(status.spilled_bytes)
+  );
+}
+
+Rcpp::RObject wrap_instrumentation(const Instrumentation& instrumentation) {
+  if(!instrumentation.enabled) return R_NilValue;
+
+  Rcpp::List sweep_times;
+  for(const auto& times : instrumentation.sweep_times) {
+    sweep_times.push_back(Rcpp::NumericVector(times.begin(), times.end()));
+  }
+  unsigned int T = instrumentation.propagation.size();
+
+  return Rcpp::List::create(
+    Rcpp::Named("timings") = Rcpp::DataFrame::create(
+      Rcpp::Named("timepoint") = Rcpp::seq(1, T),
+      Rcpp::Named("propagation") = Rcpp::wrap(instrumentation.propagation.begin(), instrumentation.propagation.end()),
+      Rcpp::Named("weighting") = Rcpp::wrap(instrumentation.weighting.begin(), instrumentation.weighting.end()),
+      Rcpp::Named("resampling") = Rcpp::wrap(instrumentation.resampling.begin(), instrumentation.resampling.end()),
+      Rcpp::Named("rejuvenation") = Rcpp::wrap(instrumentation.rejuvenation.begin(), instrumentation.rejuvenation.end()),
+      Rcpp::Named("tau_gibbs") = Rcpp::wrap(instrumentation.tau_gibbs.begin(), instrumentation.tau_gibbs.end()),
+      Rcpp::Named("doubling") = Rcpp::wrap(instrumentation.doubling.begin(), instrumentation.doubling.end())
+    ),
+    Rcpp::Named("sweep_times") = sweep_times,
+    Rcpp::Named("counters") = Rcpp::NumericVector::create(
+      Rcpp::Named("distance_calls") = static_cast<double>(instrumentation.distance_calls.load()),
+      Rcpp::Named("logz_calls") = static_cast<double>(instrumentation.logz_calls.load()),
+      Rcpp::Named("particle_filter_reruns") = static_cast<double>(instrumentation.particle_filter_reruns),
+      Rcpp::Named("screened_proposals") = static_cast<double>(instrumentation.screened_proposals),
+      Rcpp::Named("bytes_copied") = static_cast<double>(instrumentation.bytes_copied.load())
+    )
+  );
+}
+
+Rcpp::RObject wrap_diagnostics(const Diagnostics& diagnostics) {
+  if(!diagnostics.enabled) return R_NilValue;
+
+  Rcpp::NumericMatrix inner_ess = Rcpp::wrap(diagnostics.inner_ess);
+  Rcpp::colnames(inner_ess) = Rcpp::CharacterVector::create(
+    "min", "lower_quartile", "median", "upper_quartile", "max");
+
+  Rcpp::List acceptance_rates;
+  for(const auto& rates : diagnostics.acceptance_rates) {
+    acceptance_rates.push_back(Rcpp::NumericVector(rates.begin(), rates.end()));
+  }
+
+  return Rcpp::List::create(
+    Rcpp::Named("inner_ess") = inner_ess,
+    Rcpp::Named("log_incremental_likelihood_variance") = Rcpp::NumericVector(
+      diagnostics.log_incremental_likelihood_variance.begin(),
+      diagnostics.log_incremental_likelihood_variance.end()),
+    Rcpp::Named("log_likelihood_estimator_variance") = Rcpp::NumericVector(
+      diagnostics.log_likelihood_estimator_variance.begin(),
+      diagnostics.log_likelihood_estimator_variance.end()),
+    Rcpp::Named("acceptance_rates") = acceptance_rates,
+    Rcpp::Named("unique_alphas") = Rcpp::IntegerVector(
+      diagnostics.unique_alphas.begin(), diagnostics.unique_alphas.end()),
+    Rcpp::Named("unique_rhos") = Rcpp::IntegerVector(
+      diagnostics.unique_rhos.begin(), diagnostics.unique_rhos.end()),
+    Rcpp::Named("rejuvenation_steps") = Rcpp::IntegerVector(
+      diagnostics.rejuvenation_steps.begin(), diagnostics.rejuvenation_steps.end()),
+    Rcpp::Named("tempering_steps") = Rcpp::IntegerVector(
+      diagnostics.tempering_steps.begin(), diagnostics.tempering_steps.end())
+  );
+}
+
+Rcpp::RObject wrap_proposal_tuning(const ProposalTuning& tuning) {
+  if(!tuning.enabled) return R_NilValue;
+  return Rcpp::List::create(
+    Rcpp::Named("alpha_scale") = tuning.alpha_scale_history,
+    Rcpp::Named("leap_probabilities") = tuning.leap_probabilities_history
+  );
+}
+
+// The traces keep ranks in 16 bits, and are widened when returned to R.
+Rcpp::List wrap_rank_traces(const std::vector<rank_cube>& traces) {
+  Rcpp::List result(traces.size());
+  for(size_t i{}; i < traces.size(); i++) {
+    result[i] = conv_to<ucube>::from(traces[i]);
+  }
+  return result;
+}
+
+Rcpp::List wrap_rank_traces(const std::vector<std::vector<rank_mat>>& traces) {
+  Rcpp::List result(traces.size());
+  for(size_t i{}; i < traces.size(); i++) {
+    Rcpp::List current(traces[i].size());
+    for(size_t j{}; j < traces[i].size(); j++) {
+      current[j] = conv_to<umat>::from(traces[i][j]);
+    }
+    result[i] = current;
+  }
+  return result;
+}
+
+Rcpp::List wrap_result(const SMCSampler& sampler, bool cluster_probabilities) {
+  SMCResult result = sampler.result(cluster_probabilities);
+  const ParameterTracer& tracer = sampler.tracer;
+  return Rcpp::List::create(
+    Rcpp::Named("alpha") = result.alpha,
+    Rcpp::Named("rho") = result.rho,
+    Rcpp::Named("tau") = result.tau,
+    Rcpp::Named("cluster_probabilities") = result.cluster_probabilities,
+    Rcpp::Named("ESS") = result.ESS,
+    Rcpp::Named("resampling") = result.resampling,
+    Rcpp::Named("n_particle_filters") = Rcpp::IntegerVector(
+      result.n_particle_filters.begin(), result.n_particle_filters.end()),
+    Rcpp::Named("n_particles") = Rcpp::IntegerVector(
+      result.n_particles.begin(), result.n_particles.end()),
+    Rcpp::Named("importance_weights") = result.importance_weights,
+    Rcpp::Named("log_marginal_likelihood") = result.log_marginal_likelihood,
+    Rcpp::Named("alpha_traces") = tracer.alpha_traces,
+    Rcpp::Named("rho_traces") = wrap_rank_traces(tracer.rho_traces),
+    Rcpp::Named("tau_traces") = tracer.tau_traces,
+    Rcpp::Named("log_importance_weights_traces") = tracer.log_importance_weights_traces,
+    Rcpp::Named("latent_rankings_traces") = wrap_rank_traces(tracer.latent_rankings_traces),
+    Rcpp::Named("instrumentation") = wrap_instrumentation(sampler.instrumentation),
+    Rcpp::Named("diagnostics") = wrap_diagnostics(sampler.diagnostics),
+    Rcpp::Named("proposal_tuning") = wrap_proposal_tuning(sampler.tuning),
+    Rcpp::Named("run_status") = wrap_run_status(sampler.status),
+    Rcpp::Named("trace_file") = tracer.writer ?
+      Rcpp::RObject(Rcpp::wrap(tracer.trace_file)) : Rcpp::RObject()
+  );
+}
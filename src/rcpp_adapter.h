@@ -0,0 +1,32 @@
+#pragma once
+#include <RcppArmadillo.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "data.h"
+#include "diagnostics.h"
+#include "instrumentation.h"
+#include "options.h"
+#include "parameter_tracer.h"
+#include "partition_functions.h"
+#include "prior.h"
+#include "proposal_tuning.h"
+#include "smc.h"
+
+// Conversion between R objects and the plain C++ types used by the engine.
+Prior read_prior(const Rcpp::List& input_prior);
+Options read_options(const Rcpp::List& input_options);
+std::unique_ptr<Data> read_data(
+    const Rcpp::List& input_timeseries,
+    const Rcpp::List& input_sort_matrices,
+    const Rcpp::List& input_sort_counts
+);
+std::string cardinalities_dir();
+bool r_interrupt_requested();
+Rcpp::RObject wrap_instrumentation(const Instrumentation& instrumentation);
+Rcpp::RObject wrap_diagnostics(const Diagnostics& diagnostics);
+Rcpp::RObject wrap_proposal_tuning(const ProposalTuning& tuning);
+Rcpp::RObject wrap_run_status(const RunStatus& status);
+Rcpp::List wrap_rank_traces(const std::vector<rank_cube>& traces);
+Rcpp::List wrap_rank_traces(const std::vector<std::vector<rank_mat>>& traces);
+Rcpp::List wrap_result(const SMCSampler& sampler, bool cluster_probabilities = true);
@@ -1,127 +1,229 @@
 #include <algorithm>
-#include <Rmath.h>
+#include <set>
+#include <vector>
 #include "misc.h"
 #include "particle.h"
+#include "random.h"
 #include "sample_latent_rankings.h"
 
 using namespace arma;
 
-uvec leap_and_shift(const uvec& current_rho, unsigned int cluster, const Prior& prior) {
-  unsigned int u = Rcpp::sample(prior.n_items, 1, false)[0] - 1;
-  uvec intermediate_rho = current_rho;
-  uvec rho_proposal = intermediate_rho;
-  int rho_u = intermediate_rho(u);
-  uvec support = setdiff(
-    regspace<uvec>(std::max(1, rho_u - 1), std::min(prior.n_items, rho_u + 1)),
-    uvec(rho_u)
-  );
-
-  unsigned int index = Rcpp::sample(support.size(), 1, false)[0] - 1;
-  intermediate_rho(u) = support(index);
-  for(size_t i{}; i < intermediate_rho.size(); i++) {
-    if(current_rho(i) == current_rho(u)) {
-      rho_proposal(u) = intermediate_rho(i);
-    } else if(current_rho(u) < current_rho(i) &&
-      current_rho(i) <= intermediate_rho(u) &&
-      intermediate_rho(u) > current_rho(u)) {
-      rho_proposal(i) = current_rho(i) - 1;
-    } else if(current_rho(u) > current_rho(i) &&
-      current_rho(i) >= intermediate_rho(u) &&
-      intermediate_rho(u) < current_rho(u)) {
-      rho_proposal(i) = current_rho(i) + 1;
-    } else {
-      rho_proposal(i) = current_rho(i);
-    }
+// Compares the alpha values of all clusters, since blocked moves can leave
+// the first cluster unchanged.
+int find_unique_alphas(const ParticlePopulation& population) {
+  std::set<std::vector<double>> unique_alphas;
+  for(size_t i{}; i < population.alpha.n_cols; i++) {
+    const double* alpha = population.alpha.colptr(i);
+    unique_alphas.insert(std::vector<double>(alpha, alpha + population.alpha.n_rows));
   }
-  uvec v1 = unique(rho_proposal);
-  uvec v2 = regspace<uvec>(1, prior.n_items);
-  if(!approx_equal(v1, v2, "absdiff", 0)) {
-    Rcpp::stop("Something wrong with rho proposal.");
+  return unique_alphas.size();
+}
+
+int find_unique_rhos(const ParticlePopulation& population) {
+  std::set<std::vector<uword>> unique_rhos;
+  for(size_t i{}; i < population.rho.n_slices; i++) {
+    const uword* rho = population.rho.slice_memptr(i);
+    unique_rhos.insert(std::vector<uword>(rho, rho + population.rho.n_elem_slice));
   }
+  return unique_rhos.size();
+}
 
-  return rho_proposal;
+uvec count_cluster_assignments(const ParticleFilter& pf, const Prior& prior) {
+  return hist(pf.cluster_assignments, regspace<uvec>(0, prior.n_clusters - 1));
 }
 
-int find_unique_alphas(const std::vector<Particle>& particle_vector) {
-  vec alpha0_tmp = vec(particle_vector.size());
-  std::transform(
-    particle_vector.cbegin(), particle_vector.cend(), alpha0_tmp.begin(),
-    [](const Particle& p) { return p.parameters.alpha(0); });
+vec sample_tau(const uvec& cluster_frequencies, const Prior& prior) {
+  vec tau(prior.n_clusters);
+  for(size_t cluster{}; cluster < prior.n_clusters; cluster++) {
+    tau(cluster) = random_gamma(cluster_frequencies(cluster) + prior.cluster_concentration, 1.0);
+  }
+  return normalise(tau, 1);
+}
+
+double log_dirichlet_density(const vec& x, const vec& concentration) {
+  double result = lgamma(accu(concentration));
+  for(size_t i{}; i < x.size(); i++) {
+    result += (concentration(i) - 1) * log(x(i)) - lgamma(concentration(i));
+  }
+  return result;
+}
 
-  uvec unique_particles = find_unique(alpha0_tmp);
-  return unique_particles.size();
+// Log-likelihood of the timepoints up to T, with the likelihood of timepoint T
+// raised to the given exponent.
+double tempered_log_likelihood(const vec& log_incremental_likelihood, unsigned int T,
+                               double exponent) {
+  if(exponent == 1) return sum(log_incremental_likelihood);
+  return accu(log_incremental_likelihood.head(T)) + exponent * log_incremental_likelihood(T);
 }
 
-bool Particle::rejuvenate(
+// Log-likelihood estimate from a particle filter with a few filters and fresh
+// random numbers, used as the surrogate in the first stage of delayed
+// acceptance. With complete data, a single filter gives the exact likelihood.
+double screen_log_likelihood(
+    unsigned int T, const Options& options, const Prior& prior,
+    const StaticParameters& parameters, const vec& logz,
+    const std::unique_ptr<Data>& data,
+    const std::unique_ptr<PartitionFunction>& pfun,
+    const std::unique_ptr<Distance>& distfun,
+    const std::unique_ptr<Resampler>& resampler) {
+  Options screen_options = options;
+  screen_options.n_particle_filters = options.delayed_acceptance_filters;
+  screen_options.pseudo_marginal_correlation = 0;
+  Particle screen_particle(screen_options, parameters, logz);
+  for(size_t t{}; t < T + 1; t++) {
+    screen_particle.run_particle_filter(t, prior, data, pfun, distfun, resampler, options.latent_rank_proposal);
+  }
+  return sum(screen_particle.log_incremental_likelihood);
+}
+
+MoveOutcome Particle::rejuvenate(
     unsigned int T, const Options& options, const Prior& prior,
     const std::unique_ptr<Data>& data,
     const std::unique_ptr<PartitionFunction>& pfun,
     const std::unique_ptr<Distance>& distfun,
     const std::unique_ptr<Resampler>& resampler,
-    const vec& alpha_sd
+    const std::unique_ptr<RhoProposal>& rho_kernel,
+    const vec& alpha_sd,
+    ProposalTuning& tuning,
+    double exponent
 ) {
-  vec alpha_proposal(prior.n_clusters);
-  umat rho_proposal(prior.n_items, prior.n_clusters);
+  // In blocked mode, only a random subset of the clusters is updated, and the
+  // other clusters keep their parameters and log partition functions.
+  uvec clusters = regspace<uvec>(0, prior.n_clusters - 1);
+  if(options.cluster_block_size > 0 && static_cast<int>(options.cluster_block_size) < prior.n_clusters) {
+    clusters = sort(random_permutation(prior.n_clusters).head(options.cluster_block_size));
+  }
 
-  for(size_t cluster{}; cluster < prior.n_clusters; cluster++) {
-    alpha_proposal(cluster) = R::rlnorm(log(parameters.alpha(cluster)), std::max(.001, alpha_sd(cluster)));
-    rho_proposal.col(cluster) = leap_and_shift(parameters.rho.col(cluster), cluster, prior);
+  vec alpha_proposal = parameters.alpha;
+  umat rho_proposal = parameters.rho;
+  vec logz_proposal = logz;
+  vec alpha_steps(prior.n_clusters, fill::zeros);
+  uvec leap_sizes(prior.n_clusters, fill::zeros);
+  double log_rho_proposal_ratio{};
+
+  for(auto cluster : clusters) {
+    double sdlog = std::max(.001, alpha_sd(cluster)) * tuning.alpha_scale(cluster);
+    alpha_proposal(cluster) = random_lognormal(log(parameters.alpha(cluster)), sdlog);
+    alpha_steps(cluster) = (log(alpha_proposal(cluster)) - log(parameters.alpha(cluster))) / sdlog;
+    leap_sizes(cluster) = tuning.enabled ? tuning.draw_leap_size() : options.leap_size;
+    log_rho_proposal_ratio += rho_kernel->propose(
+      rho_proposal.colptr(cluster), prior.n_items, leap_sizes(cluster));
+    logz_proposal(cluster) = pfun->logz(alpha_proposal(cluster));
   }
 
-  Particle proposal_particle(options, StaticParameters{alpha_proposal, rho_proposal, parameters.tau}, pfun);
+  // With fuse_tau_update, tau is proposed from its full conditional given the
+  // cluster assignments of the conditioned particle filter, jointly with alpha
+  // and rho, so that a single filter pass per sweep updates all parameters.
+  const bool fused = options.fuse_tau_update && prior.n_clusters > 1;
+  vec tau_proposal = parameters.tau;
+  uvec cluster_frequencies;
+  if(fused) {
+    cluster_frequencies = count_cluster_assignments(
+      particle_filters[conditioned_particle_filter], prior);
+    tau_proposal = sample_tau(cluster_frequencies, prior);
+  }
 
+  StaticParameters proposed_parameters{alpha_proposal, rho_proposal, tau_proposal};
   double log_ratio{};
   vec additional_terms = prior.alpha_shape * (log(alpha_proposal) - log(parameters.alpha)) -
     prior.alpha_rate * (alpha_proposal - parameters.alpha);
+  double log_proposal_terms = accu(additional_terms) + log_rho_proposal_ratio;
+
+  // Delayed acceptance: the proposal must first pass a screen based on cheap
+  // likelihood estimates for the current and proposed parameters. The random
+  // numbers of the cheap filters are auxiliary variables which are refreshed
+  // at every move, and dividing by the first-stage ratio in the second stage
+  // keeps the posterior invariant.
+  double log_screen_ratio{};
+  if(options.delayed_acceptance_filters > 0) {
+    log_screen_ratio =
+      screen_log_likelihood(T, options, prior, proposed_parameters, logz_proposal,
+                            data, pfun, distfun, resampler) -
+      screen_log_likelihood(T, options, prior, parameters, logz,
+                            data, pfun, distfun, resampler) +
+      log_proposal_terms;
+    if(log_screen_ratio <= log(random_uniform())) {
+      tuning.record(alpha_steps, leap_sizes, false);
+      return MoveOutcome::screened_out;
+    }
+  }
+
+  Particle proposal_particle(options, proposed_parameters, logz_proposal);
+  if(auxiliary.enabled) {
+    proposal_particle.auxiliary = auxiliary.perturb(options.pseudo_marginal_correlation);
+  }
 
   for(size_t t{}; t < T + 1; t++) {
     proposal_particle.run_particle_filter(t, prior, data, pfun, distfun, resampler, options.latent_rank_proposal);
   }
 
-  log_ratio = sum(proposal_particle.log_incremental_likelihood) -
-    sum(this->log_incremental_likelihood) + accu(additional_terms);
-
-  Rcpp::NumericVector probs = Rcpp::exp(proposal_particle.log_normalized_particle_filter_weights);
-  int proposed_particle_filter = Rcpp::sample(probs.size(), 1, false, probs, false)[0];
+  log_ratio = tempered_log_likelihood(proposal_particle.log_incremental_likelihood, T, exponent) -
+    tempered_log_likelihood(this->log_incremental_likelihood, T, exponent) + log_proposal_terms;
+
+  int proposed_particle_filter = random_index(
+    exp(proposal_particle.log_normalized_particle_filter_weights));
+
+  if(fused) {
+    // Prior ratio and reverse over forward proposal ratio for tau
+    vec prior_concentration(prior.n_clusters, fill::value(prior.cluster_concentration));
+    uvec proposal_cluster_frequencies = count_cluster_assignments(
+      proposal_particle.particle_filters[proposed_particle_filter], prior);
+    log_ratio +=
+      log_dirichlet_density(tau_proposal, prior_concentration) -
+      log_dirichlet_density(parameters.tau, prior_concentration) +
+      log_dirichlet_density(parameters.tau, prior_concentration + conv_to<vec>::from(proposal_cluster_frequencies)) -
+      log_dirichlet_density(tau_proposal, prior_concentration + conv_to<vec>::from(cluster_frequencies));
+  }
 
-  bool accepted{};
-  if(log_ratio > log(R::runif(0, 1))) {
-    this->parameters = StaticParameters{alpha_proposal, rho_proposal, parameters.tau};
+  if(log_ratio - log_screen_ratio > log(random_uniform())) {
+    this->parameters = std::move(proposed_parameters);
     this->conditioned_particle_filter = proposed_particle_filter;
-    this->log_incremental_likelihood = proposal_particle.log_incremental_likelihood;
-    this->log_normalized_particle_filter_weights = proposal_particle.log_normalized_particle_filter_weights;
-    this->particle_filters = proposal_particle.particle_filters;
-    this->logz = proposal_particle.logz;
-    accepted = true;
-  } else {
-    accepted = false;
+    this->log_incremental_likelihood = std::move(proposal_particle.log_incremental_likelihood);
+    this->log_normalized_particle_filter_weights = std::move(proposal_particle.log_normalized_particle_filter_weights);
+    this->weight_variance_sum = proposal_particle.weight_variance_sum;
+    this->particle_filters = std::move(proposal_particle.particle_filters);
+    this->logz = std::move(proposal_particle.logz);
+    this->auxiliary = std::move(proposal_particle.auxiliary);
+    tuning.record(alpha_steps, leap_sizes, true);
+    return MoveOutcome::accepted;
   }
 
-  if(prior.n_clusters > 1) {
-    uvec cluster_assignments = particle_filters[conditioned_particle_filter].cluster_assignments;
-    uvec cluster_frequencies = hist(cluster_assignments, regspace<uvec>(0, prior.n_clusters - 1));
+  tuning.record(alpha_steps, leap_sizes, false);
+  return MoveOutcome::rejected;
+}
 
-    for(size_t cluster{}; cluster < prior.n_clusters; cluster++) {
-      parameters.tau(cluster) = R::rgamma(cluster_frequencies(cluster) + prior.cluster_concentration, 1.0);
-    }
-    parameters.tau = normalise(parameters.tau, 1);
+void Particle::update_tau(
+    unsigned int T, const Options& options, const Prior& prior,
+    const std::unique_ptr<Data>& data,
+    const std::unique_ptr<PartitionFunction>& pfun,
+    const std::unique_ptr<Distance>& distfun,
+    const std::unique_ptr<Resampler>& resampler
+) {
+  if(prior.n_clusters > 1) {
+    parameters.tau = sample_tau(
+      count_cluster_assignments(particle_filters[conditioned_particle_filter], prior), prior);
     Particle gibbs_particle(options, this->parameters, pfun);
     gibbs_particle.conditioned_particle_filter = 0;
-    gibbs_particle.particle_filters[0] = this->particle_filters[this->conditioned_particle_filter];
-    gibbs_particle.particle_filters[0].cluster_probabilities = mat{};
+    if(options.ancestor_sampling) {
+      gibbs_particle.reference = this->particle_filters[this->conditioned_particle_filter];
+      restore_latent_rankings(gibbs_particle.reference);
+    } else {
+      gibbs_particle.particle_filters[0] = this->particle_filters[this->conditioned_particle_filter];
+      restore_latent_rankings(gibbs_particle.particle_filters[0]);
+    }
 
     for(size_t t{}; t < T + 1; t++) {
-      gibbs_particle.run_particle_filter(t, prior, data, pfun, distfun, resampler, options.latent_rank_proposal, true);
+      gibbs_particle.run_particle_filter(t, prior, data, pfun, distfun, resampler,
+                                         options.latent_rank_proposal, true,
+                                         options.ancestor_sampling);
     }
 
     this->log_incremental_likelihood = gibbs_particle.log_incremental_likelihood;
     this->log_normalized_particle_filter_weights = gibbs_particle.log_normalized_particle_filter_weights;
+    this->weight_variance_sum = gibbs_particle.weight_variance_sum;
     this->particle_filters = gibbs_particle.particle_filters;
     this->logz = gibbs_particle.logz;
 
     sample_particle_filter();
   }
-
-
-  return accepted;
 }
@@ -1,4 +1,6 @@
 #include <memory>
+#include <stdexcept>
+#include "random.h"
 #include "resampler.h"
 
 using namespace arma;
@@ -26,17 +28,25 @@ ivec count_between_intervals(const vec& cumprob, const vec& u) {
 
 ivec stratsys(int n_samples, vec probs, bool stratified) {
   vec u(n_samples);
-  vec rn = stratified ? Rcpp::runif(n_samples) : vec(n_samples, fill::value(R::runif(0, 1)));
+  vec rn(n_samples);
+  if(stratified) {
+    for(size_t i{}; i < n_samples; i++) rn(i) = random_uniform();
+  } else {
+    rn.fill(random_uniform());
+  }
 
   for(size_t i{}; i < n_samples; i++) u(i) = (i + rn(i)) / n_samples;
   return count_between_intervals(cumsum(probs), u);
 }
 
+ivec systematic_counts(int n_samples, const vec& probs, double u) {
+  if(n_samples == 0) return zeros<ivec>(probs.n_elem);
+  vec points = (regspace(0, n_samples - 1) + u) / n_samples;
+  return count_between_intervals(cumsum(probs), points);
+}
+
 ivec resample_counts(unsigned int size, vec& probs) {
-  unsigned int N = probs.size();
-  ivec outcome = zeros<ivec>(N);
-  R::rmultinom(size, probs.begin(), N, outcome.begin());
-  return outcome;
+  return random_multinomial(size, probs);
 }
 
 ivec Multinomial::resample(int n_samples, vec probs) {
@@ -72,6 +82,6 @@ std::unique_ptr<Resampler> choose_resampler(std::string resampler) {
   } else if(resampler == "systematic") {
     return std::make_unique<Systematic>();
   } else {
-    Rcpp::stop("Unknown resampler.");
+    throw std::invalid_argument("Unknown resampler.");
   }
 }
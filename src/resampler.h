@@ -1,11 +1,17 @@
 #pragma once
-#include <RcppArmadillo.h>
+#include <atomic>
+#include <memory>
+#include <string>
 #include <vector>
+#include "arma.h"
 
 struct Resampler {
   Resampler() {};
   virtual ~Resampler() = default;
   virtual arma::ivec resample(int n_samples, arma::vec probs) = 0;
+  // Counter of the bytes copied by update_vector() when resampling with this
+  // resampler, or null if they are not counted. Each sampler has its own.
+  std::atomic<unsigned long long>* copied_bytes{};
 };
 
 struct Multinomial : Resampler {
@@ -26,8 +32,14 @@ struct Systematic : Resampler {
 
 std::unique_ptr<Resampler> choose_resampler(std::string resampler);
 
+// Systematic resampling with the single uniform u given, rather than drawn.
+arma::ivec systematic_counts(int n_samples, const arma::vec& probs, double u);
+
+// Adds the number of bytes copied to copied_bytes, if given. The element type
+// must then provide an overload of memory_size().
 template <typename T>
-std::vector<T> update_vector(const arma::ivec& counts, const std::vector<T>& particle_vector) {
+std::vector<T> update_vector(const arma::ivec& counts, const std::vector<T>& particle_vector,
+                             std::atomic<unsigned long long>* copied_bytes = nullptr) {
   size_t total_size = sum(counts);
   std::vector<T> result(total_size);
 
@@ -38,6 +50,9 @@ std::vector<T> update_vector(const arma::ivec& counts, const std::vector<T>& par
     if (count > 0) {
       std::fill_n(result_ptr, count, particle_vector[i]);
       result_ptr += count;
+      if (copied_bytes) {
+        *copied_bytes += count * memory_size(particle_vector[i]);
+      }
     }
   }
 
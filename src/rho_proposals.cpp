@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include "random.h"
+#include "rho_proposals.h"
+
+using namespace arma;
+
+namespace {
+// Moves item u to new_rank, shifting the items ranked between its old and
+// new rank towards the old rank.
+void move_item(uword* rho, unsigned int n_items, unsigned int u, uword new_rank) {
+  const uword old_rank = rho[u];
+  for(unsigned int i{}; i < n_items; i++) {
+    if(old_rank < rho[i] && rho[i] <= new_rank) {
+      rho[i]--;
+    } else if(new_rank <= rho[i] && rho[i] < old_rank) {
+      rho[i]++;
+    }
+  }
+  rho[u] = new_rank;
+}
+
+// Moves a random item to a rank drawn uniformly among the other ranks at most
+// leap away, and returns the log proposal ratio.
+double leap_and_shift(uword* rho, unsigned int n_items, unsigned int leap) {
+  if(n_items < 2) return 0;
+  const int max_leap = std::min(std::max(leap, 1U), n_items - 1);
+  const int n = n_items;
+  auto lower = [max_leap](int rank) { return std::max(1, rank - max_leap); };
+  auto support_size = [n, max_leap, lower](int rank) {
+    return std::min(n, rank + max_leap) - lower(rank);
+  };
+
+  unsigned int u = random_index(n_items);
+  const int old_rank = rho[u];
+  int new_rank = lower(old_rank) + random_index(support_size(old_rank));
+  if(new_rank >= old_rank) new_rank++;
+  move_item(rho, n_items, u, new_rank);
+
+#ifndef NDEBUG
+  validate_ranking(rho, n_items);
+#endif
+
+  // A move to a neighbouring rank can also be reached by moving the item it
+  // swaps with, which makes it symmetric.
+  if(std::abs(new_rank - old_rank) == 1) return 0;
+  return std::log(support_size(old_rank)) - std::log(support_size(new_rank));
+}
+}
+
+double LeapAndShift::propose(uword* rho, unsigned int n_items, unsigned int leap_size) const {
+  return leap_and_shift(rho, n_items, leap_size);
+}
+
+double Swap::propose(uword* rho, unsigned int n_items, unsigned int leap_size) const {
+  if(n_items < 2) return 0;
+  const unsigned int leap = std::min(std::max(leap_size, 1U), n_items - 1);
+  const uword first_rank = random_index(n_items - leap) + 1;
+  const uword second_rank = first_rank + leap;
+  for(unsigned int i{}; i < n_items; i++) {
+    if(rho[i] == first_rank) {
+      rho[i] = second_rank;
+    } else if(rho[i] == second_rank) {
+      rho[i] = first_rank;
+    }
+  }
+
+#ifndef NDEBUG
+  validate_ranking(rho, n_items);
+#endif
+
+  return 0;
+}
+
+double Insertion::propose(uword* rho, unsigned int n_items, unsigned int) const {
+  return leap_and_shift(rho, n_items, n_items);
+}
+
+std::unique_ptr<RhoProposal> choose_rho_proposal(std::string rho_proposal) {
+  if(rho_proposal == "leap_and_shift") {
+    return std::make_unique<LeapAndShift>();
+  } else if(rho_proposal == "swap") {
+    return std::make_unique<Swap>();
+  } else if(rho_proposal == "insertion") {
+    return std::make_unique<Insertion>();
+  } else {
+    throw std::invalid_argument("Unknown rho proposal.");
+  }
+}
+
+void validate_ranking(const uword* rho, unsigned int n_items) {
+  std::vector<bool> seen(n_items);
+  for(unsigned int i{}; i < n_items; i++) {
+    if(rho[i] < 1 || rho[i] > n_items || seen[rho[i] - 1]) {
+      throw std::runtime_error("Something wrong with rho proposal.");
+    }
+    seen[rho[i] - 1] = true;
+  }
+}
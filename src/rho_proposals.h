@@ -0,0 +1,40 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "arma.h"
+
+// Proposals for the modal ranking of a cluster. propose() modifies the
+// ranking rho of n_items items in place, without allocating memory, and
+// returns the log of the reverse over the forward proposal probability.
+struct RhoProposal {
+  RhoProposal() {};
+  virtual ~RhoProposal() = default;
+  virtual double propose(arma::uword* rho, unsigned int n_items,
+                         unsigned int leap_size) const = 0;
+};
+
+// Moves a random item to a different rank at most leap_size away, and shifts
+// the items in between by one.
+struct LeapAndShift : RhoProposal {
+  double propose(arma::uword* rho, unsigned int n_items,
+                 unsigned int leap_size) const override;
+};
+
+// Swaps the items at ranks u and u + leap_size, for a random u.
+struct Swap : RhoProposal {
+  double propose(arma::uword* rho, unsigned int n_items,
+                 unsigned int leap_size) const override;
+};
+
+// Moves a random item to any other rank, and shifts the items in between by
+// one. The leap size is ignored.
+struct Insertion : RhoProposal {
+  double propose(arma::uword* rho, unsigned int n_items,
+                 unsigned int leap_size) const override;
+};
+
+std::unique_ptr<RhoProposal> choose_rho_proposal(std::string rho_proposal);
+
+// Throws if rho is not a permutation of 1, ..., n_items. The proposals only
+// call it in builds without NDEBUG.
+void validate_ranking(const arma::uword* rho, unsigned int n_items);
@@ -1,12 +1,12 @@
-#include <RcppArmadillo.h>
+#include <stdexcept>
 #include "sample_latent_rankings.h"
 #include "data.h"
 #include "misc.h"
+#include "random.h"
 using namespace arma;
 
-uvec shuffle_rcpp(const uvec& values_in) {
-  ivec inds = Rcpp::sample(values_in.size(), values_in.size(), false) - 1;
-  return values_in(conv_to<uvec>::from(inds));
+uvec shuffle_values(const uvec& values_in, RandomSource& random) {
+  return values_in(random.permutation(values_in.size()));
 }
 
 LatentRankingProposal sample_latent_rankings(
@@ -14,15 +14,16 @@ LatentRankingProposal sample_latent_rankings(
     std::string latent_rank_proposal,
     const StaticParameters& parameters,
     const std::unique_ptr<PartitionFunction>& pfun,
-    const std::unique_ptr<Distance>& distfun
+    const std::unique_ptr<Distance>& distfun,
+    RandomSource& random
 ) {
   if(Rankings* r = dynamic_cast<Rankings*>(data.get())) {
     return sample_latent_rankings(r, t, latent_rank_proposal,
-                                  parameters, pfun, distfun);
+                                  parameters, pfun, distfun, random);
   } else if (PairwisePreferences* pp = dynamic_cast<PairwisePreferences*>(data.get())) {
-    return sample_latent_rankings(pp, t, prior);
+    return sample_latent_rankings(pp, t, prior, random);
   } else {
-    Rcpp::stop("Unknown type.");
+    throw std::runtime_error("Unknown type.");
   }
 }
 
@@ -31,7 +32,8 @@ LatentRankingProposal sample_latent_rankings(
     std::string latent_rank_proposal,
     const StaticParameters& parameters,
     const std::unique_ptr<PartitionFunction>& pfun,
-    const std::unique_ptr<Distance>& distfun)  {
+    const std::unique_ptr<Distance>& distfun,
+    RandomSource& random)  {
 
   LatentRankingProposal proposal;
   ranking_tp new_data = data->timeseries[t];
@@ -46,17 +48,17 @@ LatentRankingProposal sample_latent_rankings(
       uvec tmp = ndit->second.observation;
 
       if(latent_rank_proposal == "uniform") {
-        tmp(ndit->second.available_items) = shuffle_rcpp(ndit->second.available_rankings);
+        tmp(ndit->second.available_items) = shuffle_values(ndit->second.available_rankings, random);
         proposal.proposal = join_horiz(proposal.proposal, tmp);
         proposal.log_probability = join_vert(
           proposal.log_probability, vec{-lgamma(ndit->second.available_rankings.size() + 1.0)});
       } else if(latent_rank_proposal == "pseudo") {
         if(parameters.alpha.size() > 1) {
-          Rcpp::stop("Pseudolikelihood proposal does not work with clusters.");
+          throw std::runtime_error("Pseudolikelihood proposal does not work with clusters.");
         }
         double logprob{0};
 
-        uvec available_items_shuffled = shuffle_rcpp(ndit->second.available_items);
+        uvec available_items_shuffled = shuffle_values(ndit->second.available_items, random);
         uvec available_rankings = ndit->second.available_rankings;
 
         while(available_items_shuffled.size() > 1) {
@@ -65,13 +67,12 @@ LatentRankingProposal sample_latent_rankings(
 
           vec probs = exp(softmax(-parameters.alpha(0) * abs(conv_to<vec>::from(rho0) - conv_to<vec>::from(available_rankings))));
 
-          Rcpp::IntegerVector sampled_index = Rcpp::sample(
-            probs.size(), 1, true, Rcpp::as<Rcpp::NumericMatrix>(Rcpp::wrap(probs)), false);
+          unsigned int sampled_index = random.index(probs);
 
-          tmp(available_items_shuffled(0)) = available_rankings(sampled_index(0));
-          logprob += log(probs(sampled_index(0)));
+          tmp(available_items_shuffled(0)) = available_rankings(sampled_index);
+          logprob += log(probs(sampled_index));
           available_items_shuffled = available_items_shuffled(span(1, available_items_shuffled.size() - 1));
-          available_rankings = setdiff(available_rankings, uvec{available_rankings(sampled_index(0))});
+          available_rankings = setdiff(available_rankings, uvec{available_rankings(sampled_index)});
         }
 
         if(available_items_shuffled.size() == 1) {
@@ -79,14 +80,14 @@ LatentRankingProposal sample_latent_rankings(
         }
 
         if(!approx_equal(sort(tmp), regspace<uvec>(1, tmp.size()), "absdiff", 0)) {
-          Rcpp::stop("Not a ranking.");
+          throw std::runtime_error("Not a ranking.");
         }
 
         proposal.proposal = join_horiz(proposal.proposal, tmp);
         proposal.log_probability = join_vert(proposal.log_probability, vec{logprob});
 
       } else {
-        Rcpp::stop("Unknown latent rank proposal.");
+        throw std::runtime_error("Unknown latent rank proposal.");
       }
     } else {
       proposal.proposal = ndit->second.observation;
@@ -104,13 +105,8 @@ LatentRankingProposal sample_latent_rankings(
       }
 
       log_cluster_probabilities = softmax(log_cluster_probabilities);
-      proposal.cluster_probabilities = join_rows(proposal.cluster_probabilities, exp(log_cluster_probabilities));
 
-      unsigned int z = Rcpp::sample(
-        parameters.tau.size(), 1, false,
-        Rcpp::as<Rcpp::NumericVector>(Rcpp::wrap(exp(log_cluster_probabilities))),
-        false
-      )(0);
+      unsigned int z = random.index(exp(log_cluster_probabilities));
       proposal.cluster_assignment = join_vert(proposal.cluster_assignment, uvec{z});
     }
   }
@@ -119,21 +115,23 @@ LatentRankingProposal sample_latent_rankings(
 }
 
 LatentRankingProposal sample_latent_rankings(
-    const PairwisePreferences* data, unsigned int t, const Prior& prior) {
+    const PairwisePreferences* data, unsigned int t, const Prior& prior,
+    RandomSource& random) {
   LatentRankingProposal proposal;
   proposal.proposal = umat(prior.n_items, data->timeseries[t].size());
-  pairwise_tp new_data = data->timeseries[t];
-  sort_matrices_tp new_sort_matrices = data->sort_matrix_timeseries[t];
-  sort_counts_tp new_sort_counts = data->sort_count_timeseries[t];
+  const pairwise_tp& new_data = data->timeseries[t];
+  const sort_matrices_tp& new_sort_matrices = data->sort_matrix_timeseries[t];
+  const sort_counts_tp& new_sort_counts = data->sort_count_timeseries[t];
   size_t proposal_index{};
 
   for(auto ndit = new_data.begin(); ndit != new_data.end(); ++ndit) {
-    umat sort_matrix = new_sort_matrices[ndit->first];
-    int random_index = Rcpp::sample(sort_matrix.n_cols, 1, false)[0] - 1;
+    const rank_mat& sort_matrix = new_sort_matrices.at(ndit->first);
+    unsigned int sort_index = random.index(sort_matrix.n_cols);
 
-    proposal.proposal.col(proposal_index++) = sort_matrix.col(random_index);
+    proposal.proposal.col(proposal_index++) =
+      conv_to<uvec>::from(sort_matrix.col(sort_index));
     proposal.log_probability = join_vert(
-      proposal.log_probability, vec{-log(new_sort_counts[ndit->first])}
+      proposal.log_probability, vec{-log(new_sort_counts.at(ndit->first))}
     );
   }
 
@@ -1,10 +1,10 @@
 #pragma once
 #include "data.h"
 #include "particle.h"
+#include "random.h"
 
 struct LatentRankingProposal{
   arma::umat proposal{};
-  arma::mat cluster_probabilities{};
   arma::uvec cluster_assignment{};
   arma::vec log_probability{};
   std::map<unsigned int, std::string> users{};
@@ -15,14 +15,17 @@ LatentRankingProposal sample_latent_rankings(
   std::string latent_rank_proposal,
   const StaticParameters& parameters,
   const std::unique_ptr<PartitionFunction>& pfun,
-  const std::unique_ptr<Distance>& distfun
+  const std::unique_ptr<Distance>& distfun,
+  RandomSource& random = default_random_source()
 );
 LatentRankingProposal sample_latent_rankings(
     const Rankings* data, unsigned int t,
     std::string latent_rank_proposal,
     const StaticParameters& parameters,
     const std::unique_ptr<PartitionFunction>& pfun,
-    const std::unique_ptr<Distance>& distfun);
+    const std::unique_ptr<Distance>& distfun,
+    RandomSource& random);
 LatentRankingProposal sample_latent_rankings(
-    const PairwisePreferences* data, unsigned int t, const Prior& prior);
+    const PairwisePreferences* data, unsigned int t, const Prior& prior,
+    RandomSource& random);
 
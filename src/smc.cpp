@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include "misc.h"
+#include "parallel.h"
+#include "smc.h"
+
+using namespace arma;
+
+std::unique_ptr<PartitionFunction> count_calls(
+    std::unique_ptr<PartitionFunction> pfun, Instrumentation& instrumentation) {
+  if(!instrumentation.enabled) return pfun;
+  return std::make_unique<CountingPartitionFunction>(
+    std::move(pfun), instrumentation.logz_calls);
+}
+
+std::unique_ptr<Distance> count_calls(
+    std::unique_ptr<Distance> distfun, Instrumentation& instrumentation) {
+  if(!instrumentation.enabled) return distfun;
+  return std::make_unique<CountingDistance>(
+    std::move(distfun), instrumentation.distance_calls);
+}
+
+std::unique_ptr<Resampler> count_copies(
+    std::unique_ptr<Resampler> resampler, Instrumentation& instrumentation) {
+  if(instrumentation.enabled) resampler->copied_bytes = &instrumentation.bytes_copied;
+  return resampler;
+}
+
+SMCSampler::SMCSampler(
+  std::unique_ptr<Data> data, const Prior& prior, const Options& options,
+  std::unique_ptr<PartitionFunction> pfun, std::ostream& out) :
+  prior { prior },
+  options { options },
+  data { std::move(data) },
+  instrumentation { this->options.instrument, this->data->n_original_timepoints() },
+  pfun { count_calls(std::move(pfun), instrumentation) },
+  particle_vector { create_particle_vector(this->options, this->prior, this->pfun) },
+  log_importance_weights { zeros<vec>(this->particle_vector.size()) },
+  distfun { count_calls(choose_distance_function(this->options.metric), instrumentation) },
+  resampler { count_copies(choose_resampler(this->options.resampler), instrumentation) },
+  rho_kernel { choose_rho_proposal(this->options.rho_proposal) },
+  reporter { this->options.verbose, out },
+  tracer { this->options.trace, this->options.trace_latent,
+           this->options.trace_file, this->options.trace_buffer_size },
+  diagnostics { this->options.diagnostics, this->data->n_original_timepoints() },
+  tuning { this->options.adaptive_proposals, this->prior, this->data->n_original_timepoints() },
+  ESS { vec(this->data->n_original_timepoints()) },
+  resampling { zeros<ivec>(this->data->n_original_timepoints()) },
+  n_particle_filters { zeros<ivec>(this->data->n_original_timepoints()) },
+  n_particles { zeros<ivec>(this->data->n_original_timepoints()) },
+  batch_size { this->options.batch_size },
+  resampling_fraction {
+    static_cast<double>(this->options.resampling_threshold) / this->options.n_particles } {
+#ifndef BAYESMALLOWSSMC2_STANDALONE
+  if(this->options.n_threads > 1) {
+    throw std::invalid_argument("n_threads must be 1, since R's random number generator is not thread-safe.");
+  }
+#endif
+  // The Gibbs step for tau runs a conditional particle filter, whose estimate
+  // does not correspond to the stored auxiliary variables of the particle.
+  if(this->options.pseudo_marginal_correlation > 0 && this->prior.n_clusters > 1 &&
+     !this->options.fuse_tau_update) {
+    throw std::invalid_argument(
+      "pseudo_marginal_correlation > 0 requires fuse_tau_update with more than one cluster.");
+  }
+  // No tempering exponent keeps the effective sample size of n_particles
+  // equally weighted particles at n_particles, which it may even round below.
+  if(this->options.adaptive_tempering &&
+     this->options.resampling_threshold >= this->options.n_particles) {
+    throw std::invalid_argument(
+      "resampling_threshold must be less than n_particles with adaptive_tempering.");
+  }
+  if(this->prior.n_items > std::numeric_limits<rank_t>::max()) {
+    throw std::invalid_argument("The number of items cannot exceed " +
+                                std::to_string(std::numeric_limits<rank_t>::max()) + ".");
+  }
+}
+
+void SMCSampler::run() {
+  run_timer = Stopwatch{};
+  status = RunStatus{};
+  status.estimated_memory = estimate_memory();
+  reporter.report_memory(status.estimated_memory);
+  if(options.memory_budget > 0 && options.scratch_file.empty()) {
+    throw std::invalid_argument("scratch_file must be set when memory_budget is positive.");
+  }
+  // The number of timepoints grows while running when they are split into
+  // batches of users.
+  for(size_t t{ next_timepoint }; t < data->n_timepoints(); t++) {
+    // Stops only between original timepoints, so that the results describe
+    // the posterior given the completed ones.
+    if((t == 0 || data->completes_timepoint(t - 1)) && should_stop()) {
+      status.skipped_timepoints = data->n_original_timepoints() - data->origin[t];
+      if(!options.checkpoint_file.empty() && t > 0) save_checkpoint(options.checkpoint_file);
+      break;
+    }
+    step(t);
+    if(!data->completes_timepoint(t)) continue;
+    unsigned int completed = data->origin[t] + 1;
+    if(!options.checkpoint_file.empty() &&
+       ((options.checkpoint_interval > 0 && completed % options.checkpoint_interval == 0) ||
+        t + 1 == data->n_timepoints())) {
+      save_checkpoint(options.checkpoint_file);
+    }
+  }
+  tracer.flush();
+}
+
+void SMCSampler::add_timepoints(std::unique_ptr<Data> new_data) {
+  if(data->n_timepoints() == 0) {
+    data = std::move(new_data);
+  } else {
+    data->append(*new_data);
+  }
+
+  unsigned int n_timepoints = data->n_original_timepoints();
+  ESS.resize(n_timepoints);
+  resampling.resize(n_timepoints);
+  n_particle_filters.resize(n_timepoints);
+  n_particles.resize(n_timepoints);
+  instrumentation.resize(n_timepoints);
+  diagnostics.resize(n_timepoints);
+  tuning.resize(n_timepoints);
+}
+
+// Runs the SMC step for timepoint t of the data. With batching, this is a
+// batch of users, and the per-timepoint outputs are indexed by the original
+// timepoint o and cover all of its batches.
+void SMCSampler::step(unsigned int t) {
+  reporter.report_time(t);
+
+  if(batch_size > 0) data->split(t, batch_size);
+  const unsigned int o = data->origin[t];
+  const bool batched = !data->completes_timepoint(t) || (t > 0 && data->origin[t - 1] == o);
+
+  Stopwatch timer;
+  with_threads(options.n_threads, [&] {
+    parallel_for(particle_vector.size(), [&](size_t i) {
+      particle_vector[i].run_particle_filter(t, prior, data, pfun, distfun, resampler,
+                                             options.latent_rank_proposal);
+      particle_vector[i].sample_particle_filter();
+    });
+  });
+  vec log_incremental_likelihood = log_incremental_likelihoods(particle_vector, t);
+  if(!options.adaptive_tempering) {
+    // Weighted by the importance weights before timepoint t, as in temper().
+    log_marginal_likelihood += log_sum_exp(
+      normalize_log_importance_weights(log_importance_weights) + log_incremental_likelihood);
+    log_importance_weights += log_incremental_likelihood;
+  }
+  if(instrumentation.enabled) instrumentation.propagation(o) += timer.elapsed();
+  unsigned int first_step = t;
+  while(first_step > 0 && data->origin[first_step - 1] == o) first_step--;
+  diagnostics.update_propagation(particle_vector, o, first_step, t);
+
+  if(options.adaptive_tempering) temper(t);
+
+  timer = Stopwatch{};
+  vec normalized_log_importance_weights = normalize_log_importance_weights(log_importance_weights);
+
+  ESS(o) = pow(norm(exp(normalized_log_importance_weights), 2), -2);
+  reporter.report_ess(ESS(o));
+  if(instrumentation.enabled) instrumentation.weighting(o) += timer.elapsed();
+
+  // Smaller batches when the batch made the effective sample size collapse,
+  // and larger ones when it stayed high. Only batches of a split timepoint say
+  // anything about the batch size, and there is no use in batches larger than
+  // the largest timepoint.
+  if(batch_size > 0 && options.adaptive_batch_size) {
+    if(ESS(o) < options.resampling_threshold) {
+      batch_size = std::max(1U, batch_size / 2);
+    } else if(batched && ESS(o) > (particle_vector.size() + options.resampling_threshold) / 2.0) {
+      unsigned int max_users{};
+      for(size_t s{}; s < data->n_timepoints(); s++) {
+        max_users = std::max(max_users, data->n_users(s));
+      }
+      if(batch_size < max_users) batch_size = std::min(2 * batch_size, max_users);
+    }
+  }
+
+  if(ESS(o) < options.resampling_threshold) {
+    resampling(o) = 1;
+    reporter.report_resampling();
+    double acceptance_rate = resample_move(t, normalized_log_importance_weights, 1);
+
+    // A rejuvenation cut short says nothing about the acceptance rate.
+    bool stopped = status.deadline_reached || status.interrupted;
+    if(!stopped && options.target_log_likelihood_variance > 0) {
+      adapt_particle_filters(t);
+    } else if(!stopped && acceptance_rate < options.doubling_threshold && options.n_particle_filters < options.max_particle_filters) {
+      timer = Stopwatch{};
+      for(size_t i{}; i < particle_vector.size(); i++) {
+        Particle& p = particle_vector[i];
+        int S = p.particle_filters.size() * 2;
+        if(p.auxiliary.enabled) {
+          log_importance_weights(i) += p.rerun_particle_filters(
+            t, S, options, prior, data, pfun, distfun, resampler);
+          continue;
+        }
+        double log_Z_old = compute_log_Z(p.particle_filters, t);
+
+        ivec new_counts = resampler->resample(S, exp(p.log_normalized_particle_filter_weights));
+        p.particle_filters = update_vector(new_counts, p.particle_filters, resampler->copied_bytes);
+        p.log_normalized_particle_filter_weights = vec(S, fill::value(-log(p.particle_filters.size())));
+
+        double log_Z_new = compute_log_Z(p.particle_filters, t);
+        log_importance_weights(i) += log_Z_new - log_Z_old;
+      }
+      options.n_particle_filters *= 2;
+      reporter.report_expansion(options.n_particle_filters);
+      if(instrumentation.enabled) instrumentation.doubling(o) += timer.elapsed();
+    }
+  }
+
+  ParticlePopulation population{particle_vector};
+  if(data->completes_timepoint(t)) {
+    tracer.update_trace(particle_vector, population, log_importance_weights, o);
+  }
+  diagnostics.update_population(particle_vector, population, o);
+  tuning.update_history(o);
+  n_particle_filters(o) = options.n_particle_filters;
+  n_particles(o) = particle_vector.size();
+  next_timepoint = t + 1;
+  if(options.memory_budget > 0) enforce_memory_budget();
+}
+
+// Moves from the posterior given the timepoints before t to the posterior
+// including timepoint t through tempered targets, in which the likelihood of
+// timepoint t is raised to an exponent increasing from zero to one. Each
+// exponent is the largest keeping the effective sample size above
+// resampling_threshold, found by bisection, and the particles are resampled
+// and rejuvenated at each intermediate exponent. If there is no such exponent,
+// the remaining increment is taken at once. On return, the importance
+// weights include the last increment.
+void SMCSampler::temper(unsigned int t) {
+  const unsigned int o = data->origin[t];
+  Stopwatch timer;
+  vec log_incremental_likelihood = log_incremental_likelihoods(particle_vector, t);
+
+  double exponent{};
+  while(true) {
+    vec normalized_log_importance_weights = normalize_log_importance_weights(log_importance_weights);
+    auto ess = [&](double increment) {
+      vec log_weights = softmax(normalized_log_importance_weights + increment * log_incremental_likelihood);
+      return pow(norm(exp(log_weights), 2), -2);
+    };
+
+    double increment = 1 - exponent;
+    bool last = ess(increment) >= options.resampling_threshold;
+    if(!last) {
+      double lower{}, upper{increment};
+      for(size_t i{}; i < 30; i++) {
+        double mid = (lower + upper) / 2;
+        if(ess(mid) >= options.resampling_threshold) lower = mid; else upper = mid;
+      }
+      // When no increment keeps the effective sample size above the
+      // threshold, as with the weights carried over already below it or a
+      // threshold of n_particles, tempering cannot help, and the rest of the
+      // likelihood is added in one step.
+      if(lower > 0) increment = lower; else last = true;
+    }
+
+    log_marginal_likelihood += log_sum_exp(
+      normalized_log_importance_weights + increment * log_incremental_likelihood);
+    log_importance_weights += increment * log_incremental_likelihood;
+    if(last) break;
+
+    exponent += increment;
+    reporter.report_tempering(exponent);
+    if(diagnostics.enabled) diagnostics.tempering_steps(o)++;
+    if(instrumentation.enabled) instrumentation.weighting(o) += timer.elapsed();
+
+    resample_move(t, normalize_log_importance_weights(log_importance_weights), exponent);
+    log_incremental_likelihood = log_incremental_likelihoods(particle_vector, t);
+    timer = Stopwatch{};
+  }
+  if(instrumentation.enabled) instrumentation.weighting(o) += timer.elapsed();
+}
+
+// Sets the number of particle filters so that the estimated variance of the
+// log-likelihood estimates is close to options.target_log_likelihood_variance.
+// With S filters, the variance is estimated by the particles' running sums of
+// squared weight coefficients of variation divided by S, so the history is not
+// rescanned. The filters are resampled to the new count, which leaves the
+// log-likelihood estimates up to timepoint t and thus the importance weights
+// unchanged. With correlated pseudo-marginal moves they are rerun instead,
+// see Particle::rerun_particle_filters(). To avoid oscillating, the count only
+// shrinks when the target is less than half of it.
+void SMCSampler::adapt_particle_filters(unsigned int t) {
+  double weight_variance_sum{};
+  for(const auto& p : particle_vector) weight_variance_sum += p.weight_variance_sum;
+  weight_variance_sum /= particle_vector.size();
+
+  double target = std::ceil(weight_variance_sum / options.target_log_likelihood_variance);
+  unsigned int S = std::min<double>(std::max(target, 1.0), options.max_particle_filters);
+  if(S <= options.n_particle_filters && 2 * S >= options.n_particle_filters) return;
+
+  Stopwatch timer;
+  for(size_t i{}; i < particle_vector.size(); i++) {
+    Particle& p = particle_vector[i];
+    if(p.auxiliary.enabled) {
+      log_importance_weights(i) += p.rerun_particle_filters(
+        t, S, options, prior, data, pfun, distfun, resampler);
+      continue;
+    }
+    ivec new_counts = resampler->resample(S, exp(p.log_normalized_particle_filter_weights));
+    p.particle_filters = update_vector(new_counts, p.particle_filters, resampler->copied_bytes);
+    p.log_normalized_particle_filter_weights = vec(S, fill::value(-log(p.particle_filters.size())));
+    p.sample_particle_filter();
+  }
+  options.n_particle_filters = S;
+  reporter.report_resize(S);
+  if(instrumentation.enabled) instrumentation.doubling(data->origin[t]) += timer.elapsed();
+}
+
+// Chooses the number of particles to resample at a resampling event with
+// effective sample size ess. The population doubles when the weights have
+// collapsed to less than a tenth of the particles, or when the last
+// rejuvenation ended with fewer than half the particles unique. It shrinks by
+// a quarter when the weights kept at least a quarter of the particles and the
+// last rejuvenation made half of them unique in a single sweep. Resampling
+// gives an equally weighted sample of any size, so the importance weights
+// stay correct, and the resampling threshold is scaled with the population.
+unsigned int SMCSampler::adapt_population_size(double ess) {
+  unsigned int N = particle_vector.size();
+  bool diverse = rejuvenation_sweeps > 0 && 2 * unique_particles >= N;
+  unsigned int new_N = N;
+  if(10 * ess < N || (rejuvenation_sweeps > 0 && !diverse)) {
+    new_N = std::min(2 * N, options.max_particles);
+  } else if(4 * ess >= N && diverse && rejuvenation_sweeps == 1) {
+    new_N = std::max(3 * N / 4, options.min_particles);
+  }
+  new_N = std::max(new_N, 1U);
+
+  if(new_N != N) {
+    options.resampling_threshold = std::round(resampling_fraction * new_N);
+    options.n_particles = new_N;
+    reporter.report_population_size(new_N);
+  }
+  return new_N;
+}
+
+// Resamples the particles and rejuvenates them with MCMC targeting the
+// posterior given the timepoints up to t, with the likelihood of timepoint t
+// raised to the given exponent. Returns the acceptance rate.
+double SMCSampler::resample_move(
+    unsigned int t, const vec& normalized_log_importance_weights, double exponent) {
+  const unsigned int o = data->origin[t];
+  Stopwatch timer;
+  unsigned int N = options.adaptive_particles ?
+    adapt_population_size(pow(norm(exp(normalized_log_importance_weights), 2), -2)) :
+    normalized_log_importance_weights.size();
+  ivec new_counts = resampler->resample(N, exp(normalized_log_importance_weights));
+
+  particle_vector = update_vector(new_counts, particle_vector, resampler->copied_bytes);
+  vec alpha_sd = compute_alpha_stddev(ParticlePopulation{particle_vector});
+  if(instrumentation.enabled) instrumentation.resampling(o) += timer.elapsed();
+
+  // The Gibbs step for tau uses a conditional particle filter targeting the
+  // untempered posterior, so at intermediate exponents only the
+  // Metropolis-Hastings move is used.
+  const bool gibbs_tau = prior.n_clusters > 1 && !options.fuse_tau_update && exponent == 1;
+
+  size_t iter{};
+  double accepted{};
+  double total_moved{};
+  int n_unique_particles{};
+  bool cut_short{};
+  // Once the memory budget has been exceeded, the Gibbs step reads back the
+  // whole history of the conditioned particle filter, so it is done for one
+  // particle at a time. Every moved particle is spilled again straight away,
+  // so that the memory beyond the budget is bounded by the particle filters
+  // of one particle per thread, rather than growing with the population.
+  std::mutex spilled_gibbs_step;
+  unsigned long long spilled_bytes = spill_file ? spill_file->bytes_written : 0;
+
+  do {
+    iter++;
+    Stopwatch sweep_timer;
+    // Outcomes and Gibbs step times per particle, since the particles are
+    // moved as parallel tasks.
+    std::vector<MoveOutcome> outcomes(particle_vector.size());
+    std::vector<char> moved(particle_vector.size());
+    vec gibbs_times = zeros<vec>(particle_vector.size());
+    with_threads(options.n_threads, [&] {
+      parallel_for(particle_vector.size(), [&](size_t i) {
+        // Each particle is moved by a kernel leaving its target invariant, so
+        // stopping between particles leaves a valid population.
+        bool stop{};
+#pragma omp critical(smc_should_stop)
+        {
+          if(!cut_short && should_stop()) cut_short = true;
+          stop = cut_short;
+        }
+        if(stop) return;
+        Particle& p = particle_vector[i];
+        outcomes[i] = p.rejuvenate(
+          t, options, prior, data, pfun, distfun, resampler, rho_kernel, alpha_sd, tuning, exponent);
+        moved[i] = true;
+        if(gibbs_tau) {
+          Stopwatch gibbs_timer;
+          if(spill_file) {
+            std::lock_guard<std::mutex> lock(spilled_gibbs_step);
+            p.update_tau(t, options, prior, data, pfun, distfun, resampler);
+            for(auto& pf : p.particle_filters) spill_latent_rankings(pf, spill_file);
+          } else {
+            p.update_tau(t, options, prior, data, pfun, distfun, resampler);
+          }
+          gibbs_times(i) = gibbs_timer.elapsed();
+        }
+        if(spill_file) {
+          for(auto& pf : p.particle_filters) spill_latent_rankings(pf, spill_file);
+        }
+      });
+    });
+    if(instrumentation.enabled) instrumentation.tau_gibbs(o) += accu(gibbs_times);
+    double sweep_accepted{};
+    unsigned int sweep_screened_out{};
+    unsigned int sweep_moved{};
+    for(size_t i{}; i < particle_vector.size(); i++) {
+      if(!moved[i]) continue;
+      sweep_moved++;
+      sweep_accepted += outcomes[i] == MoveOutcome::accepted;
+      sweep_screened_out += outcomes[i] == MoveOutcome::screened_out;
+    }
+
+    accepted += sweep_accepted;
+    total_moved += sweep_moved;
+    tuning.adapt();
+    if(diagnostics.enabled) {
+      // Over the particles actually moved, as a sweep may be cut short.
+      diagnostics.acceptance_rates[o].push_back(
+        sweep_moved > 0 ? sweep_accepted / sweep_moved : datum::nan);
+    }
+
+    n_unique_particles = find_unique_alphas(ParticlePopulation{particle_vector});
+    reporter.report_rejuvenation(n_unique_particles);
+
+    if(instrumentation.enabled) {
+      double sweep_time = sweep_timer.elapsed();
+      instrumentation.sweep_times[o].push_back(sweep_time);
+      instrumentation.rejuvenation(o) += sweep_time;
+      instrumentation.particle_filter_reruns +=
+        sweep_moved * (gibbs_tau ? 2 : 1) - sweep_screened_out;
+      instrumentation.screened_proposals += sweep_screened_out;
+    }
+  } while(!cut_short && (2.0 * n_unique_particles < particle_vector.size()) &&
+          iter < options.max_rejuvenation_steps);
+  if(cut_short) status.shortened_rejuvenations++;
+  if(spill_file) status.spilled_bytes += spill_file->bytes_written - spilled_bytes;
+
+  log_importance_weights.zeros(particle_vector.size());
+  if(diagnostics.enabled) diagnostics.rejuvenation_steps(o) += iter;
+  rejuvenation_sweeps = iter;
+  unique_particles = n_unique_particles;
+
+  double acceptance_rate = total_moved > 0 ? accepted / total_moved : 0;
+  reporter.report_acceptance_rate(acceptance_rate);
+  return acceptance_rate;
+}
+
+// Estimates the memory used by the particles at the end of the run with the
+// current numbers of particles and particle filters. Each particle filter
+// keeps the latent rankings of every user and a weight per timepoint, and for
+// mixtures also a cluster assignment per user and an index per timepoint.
+double SMCSampler::estimate_memory() const {
+  double n_users{};
+  for(size_t t{}; t < data->n_timepoints(); t++) n_users += data->n_users(t);
+  double bytes_per_user = prior.n_items * sizeof(rank_t);
+  double bytes_per_timepoint = sizeof(double);
+  if(prior.n_clusters > 1) {
+    bytes_per_user += sizeof(uword);
+    bytes_per_timepoint += sizeof(uword);
+  }
+  double bytes_per_filter = sizeof(ParticleFilter) + n_users * bytes_per_user +
+    data->n_timepoints() * bytes_per_timepoint;
+  return static_cast<double>(particle_vector.size()) *
+    (sizeof(Particle) + options.n_particle_filters * bytes_per_filter);
+}
+
+// Moves the latent rankings of all particle filters to the scratch file when
+// the particles take more memory than options.memory_budget. They are only
+// read back, one particle at a time, for the reference trajectory of the
+// conditional particle filter, for traces and for checkpoints.
+void SMCSampler::enforce_memory_budget() {
+  double bytes{};
+  for(const auto& p : particle_vector) bytes += memory_size(p);
+  if(bytes <= options.memory_budget) return;
+
+  if(!spill_file) spill_file = std::make_shared<SpillFile>(options.scratch_file);
+  unsigned long long bytes_written = spill_file->bytes_written;
+  for(auto& p : particle_vector) {
+    for(auto& pf : p.particle_filters) spill_latent_rankings(pf, spill_file);
+  }
+  status.spilled_bytes += spill_file->bytes_written - bytes_written;
+}
+
+bool SMCSampler::should_stop() {
+  if(!status.interrupted && interrupt_requested && interrupt_requested()) {
+    status.interrupted = true;
+  }
+  if(!status.deadline_reached && options.time_limit > 0 &&
+     run_timer.elapsed() > options.time_limit) {
+    status.deadline_reached = true;
+  }
+  return status.deadline_reached || status.interrupted;
+}
+
+SMCResult SMCSampler::result(bool cluster_probabilities) const {
+  SMCResult result;
+  ParticlePopulation population{particle_vector};
+  result.alpha = population.alpha;
+  result.rho = population.rho;
+  result.tau = population.tau;
+  // The cluster probabilities cost a pass over all users of every particle,
+  // so callers that update often can leave them out.
+  if(cluster_probabilities && prior.n_clusters > 1) {
+    // A distance function of its own, so that the instrumentation only counts
+    // the calls made while running.
+    std::unique_ptr<Distance> distance = choose_distance_function(options.metric);
+    result.cluster_probabilities = cube(particle_vector.size(), n_latent_columns(particle_vector[0].particle_filters[0]), prior.n_clusters);
+    for(size_t i{}; i < particle_vector.size(); i++) {
+      result.cluster_probabilities.row(i) = compute_cluster_probabilities(particle_vector[i], distance).t();
+    }
+  }
+
+  // Only the completed timepoints when the last run was cut short.
+  unsigned int completed = next_timepoint == 0 ? 0 : data->origin[next_timepoint - 1] + 1;
+  result.ESS = ESS.head(completed);
+  result.resampling = resampling.head(completed);
+  result.n_particle_filters = n_particle_filters.head(completed);
+  result.n_particles = n_particles.head(completed);
+  result.importance_weights = exp(normalize_log_importance_weights(log_importance_weights));
+  result.log_marginal_likelihood = log_marginal_likelihood;
+  return result;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "arma.h"
+#include "data.h"
+#include "diagnostics.h"
+#include "distances.h"
+#include "instrumentation.h"
+#include "options.h"
+#include "parameter_tracer.h"
+#include "particle.h"
+#include "partition_functions.h"
+#include "prior.h"
+#include "progress_reporter.h"
+#include "proposal_tuning.h"
+#include "resampler.h"
+#include "rho_proposals.h"
+#include "spill_file.h"
+
+struct SMCResult {
+  arma::mat alpha{};
+  arma::ucube rho{};
+  arma::mat tau{};
+  arma::cube cluster_probabilities{};
+  arma::vec ESS{};
+  arma::ivec resampling{};
+  arma::ivec n_particle_filters{};
+  arma::ivec n_particles{};
+  arma::vec importance_weights{};
+  double log_marginal_likelihood{};
+};
+
+// How the last call to SMCSampler::run() was cut short. When the time limit is
+// reached or an interrupt is requested, the rejuvenation in progress stops
+// between particles, and no further timepoints are processed once the current
+// one is complete.
+struct RunStatus {
+  bool deadline_reached{};
+  bool interrupted{};
+  unsigned int shortened_rejuvenations{};
+  unsigned int skipped_timepoints{};
+  // Estimated bytes needed for the particles at the end of the run, and bytes
+  // of latent rankings moved to the scratch file to stay within the budget.
+  double estimated_memory{};
+  unsigned long long spilled_bytes{};
+};
+
+// The nested SMC sampler. It has no dependencies on R, and can be run from
+// any C++ program given the data, the prior, the options and a partition
+// function. The state after any timepoint can be saved with save_checkpoint(),
+// and a new sampler can continue from it with load_checkpoint() followed by
+// run(), as long as its data start with the same timepoints. New timepoints
+// can be added with add_timepoints(), after which run() processes only them.
+// Timepoints with more users than options.batch_size are split into batches,
+// each processed as its own SMC step, while the outputs are still given per
+// original timepoint.
+struct SMCSampler {
+  SMCSampler(std::unique_ptr<Data> data, const Prior& prior, const Options& options,
+             std::unique_ptr<PartitionFunction> pfun, std::ostream& out);
+  ~SMCSampler() = default;
+  void run();
+  void add_timepoints(std::unique_ptr<Data> new_data);
+  void step(unsigned int t);
+  void temper(unsigned int t);
+  double resample_move(unsigned int t, const arma::vec& normalized_log_importance_weights,
+                       double exponent);
+  void adapt_particle_filters(unsigned int t);
+  unsigned int adapt_population_size(double ess);
+  bool should_stop();
+  double estimate_memory() const;
+  void enforce_memory_budget();
+  SMCResult result(bool cluster_probabilities = true) const;
+  void save_checkpoint(const std::string& filename) const;
+  void load_checkpoint(const std::string& filename);
+
+  Prior prior;
+  Options options;
+  std::unique_ptr<Data> data;
+  Instrumentation instrumentation;
+  std::unique_ptr<PartitionFunction> pfun;
+  std::vector<Particle> particle_vector;
+  // Unnormalized log importance weights, one per particle, kept contiguous so
+  // that weight updates are vector operations.
+  arma::vec log_importance_weights;
+  std::unique_ptr<Distance> distfun;
+  std::unique_ptr<Resampler> resampler;
+  std::unique_ptr<RhoProposal> rho_kernel;
+  ProgressReporter reporter;
+  ParameterTracer tracer;
+  Diagnostics diagnostics;
+  ProposalTuning tuning;
+  unsigned int next_timepoint{};
+  double log_marginal_likelihood{};
+  arma::vec ESS;
+  arma::ivec resampling;
+  arma::ivec n_particle_filters;
+  arma::ivec n_particles;
+  // Maximum number of users per SMC step, or zero if timepoints are not split.
+  unsigned int batch_size{};
+  // Number of sweeps and unique particles at the end of the last
+  // rejuvenation, used by adapt_population_size().
+  unsigned int rejuvenation_sweeps{};
+  unsigned int unique_particles{};
+  // Resampling threshold as a fraction of the number of particles, as given
+  // in the options, from which the threshold is recomputed when the
+  // population is resized.
+  double resampling_fraction{};
+  // Checked at safe points, and returns true when the user has asked to stop.
+  // The R interface sets it to check for user interrupts. With more than one
+  // thread, it can be called from any of them, but never concurrently.
+  std::function<bool()> interrupt_requested{};
+  Stopwatch run_timer;
+  RunStatus status;
+  std::shared_ptr<SpillFile> spill_file{};
+};
@@ -0,0 +1,42 @@
+#include <cstdio>
+#include <stdexcept>
+#include "spill_file.h"
+
+using namespace arma;
+
+SpillFile::SpillFile(const std::string& filename) :
+  filename { filename },
+  file(filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc) {
+  if(!file) {
+    throw std::runtime_error("Could not open scratch file " + filename + ".");
+  }
+}
+
+SpillFile::~SpillFile() {
+  file.close();
+  std::remove(filename.c_str());
+}
+
+std::streamoff SpillFile::write(const rank_mat& x) {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::streamoff offset = end;
+  file.seekp(offset);
+  file.write(reinterpret_cast<const char*>(x.memptr()), x.n_elem * sizeof(rank_t));
+  if(!file) {
+    throw std::runtime_error("Could not write to scratch file " + filename + ".");
+  }
+  end += x.n_elem * sizeof(rank_t);
+  bytes_written += x.n_elem * sizeof(rank_t);
+  return offset;
+}
+
+rank_mat SpillFile::read(std::streamoff offset, uword n_rows, uword n_cols) {
+  rank_mat x(n_rows, n_cols);
+  std::lock_guard<std::mutex> lock(mutex);
+  file.seekg(offset);
+  file.read(reinterpret_cast<char*>(x.memptr()), x.n_elem * sizeof(rank_t));
+  if(!file) {
+    throw std::runtime_error("Could not read from scratch file " + filename + ".");
+  }
+  return x;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "arma.h"
+#include "typedefs.h"
+
+// Append-only scratch file holding latent rankings moved out of memory when
+// the memory budget is exceeded. Blocks are never modified after they are
+// written, so copies of a particle filter can share them. The file is removed
+// when the last block referring to it is destroyed.
+struct SpillFile {
+  explicit SpillFile(const std::string& filename);
+  ~SpillFile();
+  std::streamoff write(const rank_mat& x);
+  rank_mat read(std::streamoff offset, arma::uword n_rows, arma::uword n_cols);
+  const std::string filename;
+  unsigned long long bytes_written{};
+
+private:
+  // Particles rejuvenated in parallel can read back their rankings at once.
+  std::mutex mutex;
+  std::fstream file;
+  std::streamoff end{};
+};
+
+// Columns of a latent ranking matrix stored in a scratch file.
+struct SpilledBlock {
+  std::shared_ptr<SpillFile> file;
+  std::streamoff offset{};
+  arma::uword n_rows{};
+  arma::uword n_cols{};
+};
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <stdexcept>
+#include "trace_writer.h"
+
+using namespace arma;
+
+TraceWriter::TraceWriter(const std::string& filename, size_t buffer_size) :
+  out(filename, std::ios::binary | std::ios::trunc), buffer_size { buffer_size } {
+  if(!out) {
+    throw std::runtime_error("Could not open trace file " + filename + ".");
+  }
+  buffer.reserve(buffer_size);
+  const char magic[8] = {'B', 'M', 'S', 'M', 'C', '2', 'T', 'R'};
+  const uint32_t version{1}, byte_order{0x01020304};
+  append(magic, sizeof(magic));
+  append(reinterpret_cast<const char*>(&version), sizeof(version));
+  append(reinterpret_cast<const char*>(&byte_order), sizeof(byte_order));
+}
+
+TraceWriter::~TraceWriter() {
+  flush();
+}
+
+void TraceWriter::flush() {
+  if(!buffer.empty()) {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+  }
+  out.flush();
+}
+
+void TraceWriter::append(const char* data, size_t bytes) {
+  if(buffer.size() + bytes > buffer_size) flush();
+  if(bytes > buffer_size) {
+    out.write(data, bytes);
+  } else {
+    buffer.insert(buffer.end(), data, data + bytes);
+  }
+}
+
+void TraceWriter::write_header(
+    TraceField field, unsigned int t, unsigned int particle,
+    unsigned int n_rows, unsigned int n_cols, unsigned int n_slices,
+    uint32_t element_type) {
+  const uint32_t header[7] = {
+    static_cast<uint32_t>(field), t, particle, n_rows, n_cols, n_slices, element_type
+  };
+  append(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+void TraceWriter::write(TraceField field, unsigned int t, unsigned int particle,
+                        const mat& x) {
+  write_header(field, t, particle, x.n_rows, x.n_cols, 1, 0);
+  append(reinterpret_cast<const char*>(x.memptr()), x.n_elem * sizeof(double));
+}
+
+void TraceWriter::write(TraceField field, unsigned int t, unsigned int particle,
+                        const ucube& x) {
+  write_header(field, t, particle, x.n_rows, x.n_cols, x.n_slices, 1);
+  std::vector<uint32_t> values(x.begin(), x.end());
+  append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(uint32_t));
+}
+
+void TraceWriter::write(TraceField field, unsigned int t, unsigned int particle,
+                        const umat& x) {
+  write_header(field, t, particle, x.n_rows, x.n_cols, 1, 1);
+  std::vector<uint32_t> values(x.begin(), x.end());
+  append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(uint32_t));
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "arma.h"
+
+enum class TraceField : uint32_t {
+  alpha = 1, rho = 2, tau = 3, log_importance_weights = 4, latent_rankings = 5
+};
+
+// Streams trace snapshots to a binary file as they are produced, holding at
+// most buffer_size bytes in memory. The file starts with the magic string
+// "BMSMC2TR", a format version and the integer 0x01020304 for detecting byte
+// order. It is followed by one record per snapshot, consisting of seven
+// uint32 values (field, timepoint, particle, n_rows, n_cols, n_slices,
+// element type, where 0 means double and 1 means uint32) and the elements in
+// column-major order.
+struct TraceWriter {
+  TraceWriter(const std::string& filename, size_t buffer_size);
+  ~TraceWriter();
+  void write(TraceField field, unsigned int t, unsigned int particle, const arma::mat& x);
+  void write(TraceField field, unsigned int t, unsigned int particle, const arma::ucube& x);
+  void write(TraceField field, unsigned int t, unsigned int particle, const arma::umat& x);
+  void flush();
+
+private:
+  void write_header(TraceField field, unsigned int t, unsigned int particle,
+                    unsigned int n_rows, unsigned int n_cols, unsigned int n_slices,
+                    uint32_t element_type);
+  void append(const char* data, size_t bytes);
+  std::ofstream out;
+  std::vector<char> buffer;
+  const size_t buffer_size;
+};
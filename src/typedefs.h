@@ -1,8 +1,18 @@
 #pragma once
 #include <map>
-#include <RcppArmadillo.h>
+#include <set>
 #include <string>
 #include <utility>
+#include <vector>
+#include "arma.h"
+
+// Ranks and item indices in long-lived storage, i.e., the latent rankings of
+// the particle filters, the topological sorts and the traces, take 16 bits.
+// Columns are converted to arma::uvec where the kernels use them. This limits
+// the number of items to 65535.
+using rank_t = unsigned short;
+using rank_mat = arma::Mat<rank_t>;
+using rank_cube = arma::Cube<rank_t>;
 
 struct RankingObs {
   arma::uvec observation{};
@@ -16,7 +26,7 @@ using single_comparison = std::pair<unsigned int, unsigned int>;
 using comparisons = std::set<single_comparison>;
 using pairwise_tp = std::map<std::string, comparisons>;
 using pairwise_ts = std::vector<pairwise_tp>;
-using sort_matrices_tp = std::map<std::string, arma::umat>;
+using sort_matrices_tp = std::map<std::string, rank_mat>;
 using sort_matrices_ts = std::vector<sort_matrices_tp>;
 using sort_counts_tp = std::map<std::string, long long int>;
 using sort_counts_ts = std::vector<sort_counts_tp>;
@@ -0,0 +1,56 @@
+// Fits the Mallows model to simulated complete rankings without R.
+//
+//   make example && ./example ../inst/partition_function_data [n_threads]
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include "random.h"
+#include "smc.h"
+
+using namespace arma;
+
+int main(int argc, char* argv[]) {
+  std::string cardinalities_dir = argc > 1 ? argv[1] : "../inst/partition_function_data";
+  set_random_seed(1);
+
+  Prior prior;
+  prior.n_items = 5;
+
+  Options options;
+  options.n_particles = 200;
+  options.n_particle_filters = 1;
+  options.resampling_threshold = options.n_particles / 2;
+  options.n_threads = argc > 2 ? std::stoul(argv[2]) : 1;
+
+  // Ten timepoints with five users each, ranking the items in roughly the
+  // same order.
+  ranking_ts timeseries;
+  for(size_t t{}; t < 10; t++) {
+    ranking_tp timepoint;
+    for(size_t u{}; u < 5; u++) {
+      uvec ranking = regspace<uvec>(1, prior.n_items);
+      if(random_uniform() < .5) std::swap(ranking(0), ranking(1));
+      timepoint[std::to_string(t) + "_" + std::to_string(u)] = create_ranking_obs(ranking);
+    }
+    timeseries.push_back(timepoint);
+  }
+
+  try {
+    SMCSampler sampler{
+      std::make_unique<Rankings>(timeseries, false), prior, options,
+      choose_partition_function(prior.n_items, options.metric, cardinalities_dir),
+      std::cout
+    };
+    sampler.run();
+    SMCResult result = sampler.result();
+
+    std::cout << "posterior mean of alpha: "
+              << accu(result.alpha.row(0).t() % result.importance_weights) << "\n"
+              << "log marginal likelihood: " << result.log_marginal_likelihood << "\n";
+  } catch(std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}